@@ -137,6 +137,11 @@ void LocalServerIo::doClose()
     m_connection->disconnectFromServer();
 }
 
+QIODevice *LocalServerIo::takeConnection()
+{
+    return qExchange(m_connection, nullptr);
+}
+
 LocalServerImpl::LocalServerImpl(QObject *parent)
     : QConnectionAbstractServer(parent)
 {
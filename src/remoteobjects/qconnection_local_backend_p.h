@@ -90,6 +90,7 @@ public:
     QIODevice *connection() const override;
 protected:
     void doClose() override;
+    QIODevice *takeConnection() override;
 
 private:
     QLocalSocket *m_connection;
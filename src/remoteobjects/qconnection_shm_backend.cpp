@@ -0,0 +1,568 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtRemoteObjects module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "qconnection_shm_backend_p.h"
+
+#include <QtCore/qcoreapplication.h>
+#include <QtCore/qendian.h>
+#include <QtCore/qmath.h>
+#include <QtCore/qurlquery.h>
+
+#include <atomic>
+#include <cstring>
+#include <limits>
+
+QT_BEGIN_NAMESPACE
+
+// Both processes map the segment, so these are only ever accessed through atomics
+struct ShmRingHeader
+{
+    QBasicAtomicInteger<quint32> head; // bytes written in total, modulo 2^32
+    QBasicAtomicInteger<quint32> tail; // bytes read in total, modulo 2^32
+    QBasicAtomicInteger<quint32> readerSeen; // head as last seen by the reader, which wants a doorbell once it moves
+    QBasicAtomicInteger<quint32> writerWaiting; // the writer wants a doorbell once there is space
+};
+
+struct ShmSegmentHeader
+{
+    quint32 magic;
+    quint32 ringCapacity;
+};
+
+static const quint32 shmMagic = 0x5154524f; // "QTRO"
+// Per direction, unless the host URL asks for another one, see ShmServerImpl::listen()
+static const quint32 defaultRingCapacity = 1024 * 1024;
+static const quint32 minRingCapacity = 4 * 1024;
+static const quint32 maxRingCapacity = 64 * 1024 * 1024;
+static const char dataDoorbell = 'D';
+static const char spaceDoorbell = 'S';
+
+static int segmentSize(quint32 ringCapacity)
+{
+    return int(sizeof(ShmSegmentHeader) + 2 * (sizeof(ShmRingHeader) + ringCapacity));
+}
+
+static quint32 boundedSize(qint64 size)
+{
+    return quint32(qMin(size, qint64(std::numeric_limits<quint32>::max())));
+}
+
+void ShmRing::reset(ShmRingHeader *header, char *data, quint32 capacity)
+{
+    m_header = header;
+    m_data = data;
+    m_capacity = capacity;
+}
+
+quint32 ShmRing::used() const
+{
+    return m_header ? m_header->head.loadAcquire() - m_header->tail.loadAcquire() : 0;
+}
+
+quint32 ShmRing::space() const
+{
+    return m_header ? m_capacity - used() : 0;
+}
+
+quint32 ShmRing::write(const char *data, quint32 size)
+{
+    // Only this end moves head, the reader can only make more room meanwhile
+    const quint32 head = m_header->head.loadRelaxed();
+    size = qMin(size, m_capacity - (head - m_header->tail.loadAcquire()));
+    const quint32 offset = head & (m_capacity - 1);
+    const quint32 first = qMin(size, m_capacity - offset);
+    memcpy(m_data + offset, data, first);
+    memcpy(m_data, data + first, size - first);
+    m_header->head.storeRelease(head + size);
+    return size;
+}
+
+quint32 ShmRing::read(char *data, quint32 size)
+{
+    const quint32 tail = m_header->tail.loadRelaxed();
+    size = qMin(size, m_header->head.loadAcquire() - tail);
+    const quint32 offset = tail & (m_capacity - 1);
+    const quint32 first = qMin(size, m_capacity - offset);
+    memcpy(data, m_data + offset, first);
+    memcpy(data + first, m_data, size - first);
+    m_header->tail.storeRelease(tail + size);
+    return size;
+}
+
+ShmChannel::ShmChannel(QLocalSocket *socket, QObject *parent)
+    : QIODevice(parent)
+    , m_socket(socket)
+{
+    connect(m_socket, &QIODevice::readyRead, this, &ShmChannel::onSocketReadyRead);
+}
+
+ShmChannel::~ShmChannel()
+{
+    close();
+}
+
+/*
+ * Called on the server end. The segment holds one ring per direction, the
+ * first one carries data from the server end to the client end. The key is
+ * sent to the client end, which attaches once it receives it.
+ * ringCapacity has to be a power of two.
+ */
+bool ShmChannel::createSegment(const QString &key, quint32 ringCapacity)
+{
+    m_serverEnd = true;
+    m_segment.setKey(key);
+    const int size = segmentSize(ringCapacity);
+    if (!m_segment.create(size)) {
+        // Left behind by a crashed process, detaching the last user removes it
+        if (m_segment.error() == QSharedMemory::AlreadyExists && m_segment.attach())
+            m_segment.detach();
+        if (!m_segment.create(size)) {
+            qCWarning(QT_REMOTEOBJECT) << "Could not create shared memory segment:" << m_segment.errorString();
+            return false;
+        }
+    }
+
+    auto segmentHeader = static_cast<ShmSegmentHeader *>(m_segment.data());
+    segmentHeader->magic = shmMagic;
+    segmentHeader->ringCapacity = ringCapacity;
+    setupRings();
+    for (ShmRing *ring : {&m_rx, &m_tx}) {
+        ring->header()->head.storeRelaxed(0);
+        ring->header()->tail.storeRelaxed(0);
+        ring->header()->readerSeen.storeRelaxed(0);
+        ring->header()->writerWaiting.storeRelaxed(0);
+    }
+    open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+
+    const QByteArray keyData = key.toUtf8();
+    char keySize[sizeof(quint16)];
+    qToBigEndian(quint16(keyData.size()), keySize);
+    m_socket->write(keySize, sizeof(keySize));
+    m_socket->write(keyData);
+    return true;
+}
+
+bool ShmChannel::attachSegment()
+{
+    quint16 keySize;
+    if (m_socket->peek(reinterpret_cast<char *>(&keySize), sizeof(keySize)) < qint64(sizeof(keySize)))
+        return false;
+    keySize = qFromBigEndian(keySize);
+    if (m_socket->bytesAvailable() < qint64(sizeof(keySize) + keySize))
+        return false;
+    m_socket->read(sizeof(keySize));
+    m_segment.setKey(QString::fromUtf8(m_socket->read(keySize)));
+
+    if (!m_segment.attach()) {
+        qCWarning(QT_REMOTEOBJECT) << "Could not attach to shared memory segment:" << m_segment.errorString();
+        m_socket->abort();
+        return false;
+    }
+    auto segmentHeader = static_cast<const ShmSegmentHeader *>(m_segment.constData());
+    if (m_segment.size() < int(sizeof(ShmSegmentHeader)) || segmentHeader->magic != shmMagic
+            || segmentHeader->ringCapacity < minRingCapacity || segmentHeader->ringCapacity > maxRingCapacity
+            || (segmentHeader->ringCapacity & (segmentHeader->ringCapacity - 1))
+            || m_segment.size() < segmentSize(segmentHeader->ringCapacity)) {
+        qCWarning(QT_REMOTEOBJECT) << "Invalid shared memory segment" << m_segment.key();
+        m_segment.detach();
+        m_socket->abort();
+        return false;
+    }
+    setupRings();
+    open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+    emit attached();
+    return true;
+}
+
+void ShmChannel::setupRings()
+{
+    char *base = static_cast<char *>(m_segment.data());
+    const quint32 capacity = reinterpret_cast<const ShmSegmentHeader *>(base)->ringCapacity;
+    char *toClient = base + sizeof(ShmSegmentHeader);
+    char *toServer = toClient + sizeof(ShmRingHeader) + capacity;
+    ShmRing &toClientRing = m_serverEnd ? m_tx : m_rx;
+    ShmRing &toServerRing = m_serverEnd ? m_rx : m_tx;
+    toClientRing.reset(reinterpret_cast<ShmRingHeader *>(toClient), toClient + sizeof(ShmRingHeader), capacity);
+    toServerRing.reset(reinterpret_cast<ShmRingHeader *>(toServer), toServer + sizeof(ShmRingHeader), capacity);
+}
+
+void ShmChannel::onSocketReadyRead()
+{
+    if (!m_segment.isAttached()) {
+        // The server end is only detached once it was closed
+        if (m_serverEnd) {
+            m_socket->readAll();
+            return;
+        }
+        if (!attachSegment())
+            return;
+    }
+
+    bool data = false;
+    bool space = false;
+    char doorbells[64];
+    qint64 count;
+    while ((count = m_socket->read(doorbells, sizeof(doorbells))) > 0) {
+        data = data || memchr(doorbells, dataDoorbell, size_t(count)) != nullptr;
+        space = space || memchr(doorbells, spaceDoorbell, size_t(count)) != nullptr;
+    }
+    if (space)
+        writePending();
+    if (data)
+        notifyReader();
+}
+
+void ShmChannel::notifyReader()
+{
+    if (!m_rx.header())
+        return;
+    const quint32 seenHead = m_seenHead;
+    emit readyRead();
+    // The owner may have closed the channel while handling readyRead()
+    if (!m_rx.header())
+        return;
+    // Like a socket, only data written from now on notifies an owner that didn't look
+    if (m_seenHead == seenHead)
+        m_seenHead = m_rx.header()->head.loadAcquire();
+    if (!waitForDoorbell())
+        QMetaObject::invokeMethod(this, &ShmChannel::notifyReader, Qt::QueuedConnection);
+}
+
+/*
+ * Tells the writer that everything up to the head last seen by the owner
+ * was considered, so it rings once it moves head past that, i.e. once the
+ * ring goes from empty, as far as the reader is concerned, to non-empty.
+ * Returns false if more data arrived meanwhile, which may not ring.
+ */
+bool ShmChannel::waitForDoorbell()
+{
+    m_rx.header()->readerSeen.storeRelaxed(m_seenHead);
+    // Pairs with the fence in wakeReader(), at least one of both sides sees the other's store
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return m_rx.header()->head.loadAcquire() == m_seenHead;
+}
+
+bool ShmChannel::isSequential() const
+{
+    return true;
+}
+
+qint64 ShmChannel::bytesAvailable() const
+{
+    if (!m_rx.header())
+        return QIODevice::bytesAvailable();
+    m_seenHead = m_rx.header()->head.loadAcquire();
+    return QIODevice::bytesAvailable() + (m_seenHead - m_rx.header()->tail.loadRelaxed());
+}
+
+// Like the write buffer of a socket, data in the ring counts as written
+qint64 ShmChannel::bytesToWrite() const
+{
+    return m_pending.size();
+}
+
+void ShmChannel::close()
+{
+    QIODevice::close();
+    m_pending.clear();
+    m_rx.reset();
+    m_tx.reset();
+    if (m_segment.isAttached())
+        m_segment.detach();
+}
+
+qint64 ShmChannel::readData(char *data, qint64 maxSize)
+{
+    if (!m_rx.header())
+        return -1;
+    m_seenHead = m_rx.header()->head.loadAcquire();
+    const quint32 read = m_rx.read(data, boundedSize(maxSize));
+    if (read && m_rx.header()->writerWaiting.fetchAndStoreOrdered(0))
+        ringDoorbell(spaceDoorbell);
+    return read;
+}
+
+qint64 ShmChannel::writeData(const char *data, qint64 size)
+{
+    if (!m_tx.header())
+        return -1;
+    qint64 remaining = size;
+    // Anything new has to go behind what is already waiting
+    if (m_pending.isEmpty()) {
+        const quint32 head = m_tx.header()->head.loadRelaxed();
+        const quint32 written = m_tx.write(data, boundedSize(remaining));
+        if (written)
+            wakeReader(head);
+        data += written;
+        remaining -= written;
+    }
+    if (remaining > 0) {
+        const bool wasWaiting = !m_pending.isEmpty();
+        m_pending.append(data, int(remaining));
+        if (!wasWaiting) {
+            m_tx.header()->writerWaiting.fetchAndStoreOrdered(1);
+            // The reader may have made room before it could see the flag
+            if (m_tx.space())
+                QMetaObject::invokeMethod(this, &ShmChannel::writePending, Qt::QueuedConnection);
+        }
+    }
+    return size;
+}
+
+void ShmChannel::writePending()
+{
+    if (!m_tx.header())
+        return;
+    const quint32 head = m_tx.header()->head.loadRelaxed();
+    qint64 written = 0;
+    while (!m_pending.isEmpty() && m_tx.header()) {
+        const quint32 chunk = m_tx.write(m_pending.constData(), quint32(m_pending.size()));
+        if (!chunk) {
+            m_tx.header()->writerWaiting.fetchAndStoreOrdered(1);
+            if (m_tx.space())
+                continue;
+            break;
+        }
+        m_pending.remove(0, int(chunk));
+        written += chunk;
+    }
+    if (written) {
+        wakeReader(head);
+        emit bytesWritten(written);
+    }
+}
+
+// Rings only if the reader had seen everything up to previousHead, a busy reader gets to the
+// new data by itself
+void ShmChannel::wakeReader(quint32 previousHead)
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_tx.header()->readerSeen.loadRelaxed() == previousHead)
+        ringDoorbell(dataDoorbell);
+}
+
+void ShmChannel::ringDoorbell(char doorbell)
+{
+    m_socket->write(&doorbell, 1);
+    m_socket->flush();
+}
+
+ShmClientIo::ShmClientIo(QObject *parent)
+    : ClientIoDevice(parent)
+    , m_socket(new QLocalSocket(this))
+    , m_channel(new ShmChannel(m_socket, this))
+{
+    connect(m_channel, &QIODevice::readyRead, this, &ClientIoDevice::readyRead);
+    connect(m_channel, &ShmChannel::attached, this, [this]() { initializeDataStream(); });
+    connect(m_socket, &QLocalSocket::errorOccurred, this, &ShmClientIo::onError);
+    connect(m_socket, &QLocalSocket::stateChanged, this, &ShmClientIo::onStateChanged);
+}
+
+ShmClientIo::~ShmClientIo()
+{
+    close();
+}
+
+QIODevice *ShmClientIo::connection() const
+{
+    return m_channel;
+}
+
+void ShmClientIo::doClose()
+{
+    m_channel->close();
+    if (m_socket->isOpen()) {
+        connect(m_socket, &QLocalSocket::disconnected, this, &QObject::deleteLater);
+        m_socket->disconnectFromServer();
+    } else {
+        this->deleteLater();
+    }
+}
+
+void ShmClientIo::doDisconnectFromServer()
+{
+    m_channel->close();
+    m_socket->disconnectFromServer();
+}
+
+void ShmClientIo::connectToServer()
+{
+    if (!isOpen())
+        m_socket->connectToServer(url().path());
+}
+
+bool ShmClientIo::isOpen() const
+{
+    return !isClosing() && (m_socket->state() == QLocalSocket::ConnectedState
+                            || m_socket->state() == QLocalSocket::ConnectingState);
+}
+
+void ShmClientIo::onError(QLocalSocket::LocalSocketError error)
+{
+    qCDebug(QT_REMOTEOBJECT) << "onError" << error << m_socket->serverName();
+
+    switch (error) {
+    case QLocalSocket::ServerNotFoundError:
+    case QLocalSocket::UnknownSocketError:
+        //Host not there, wait and try again
+        emit shouldReconnect(this);
+        break;
+    case QLocalSocket::ConnectionError:
+    case QLocalSocket::ConnectionRefusedError:
+#ifdef Q_OS_UNIX
+        emit shouldReconnect(this);
+#endif
+        break;
+    default:
+        break;
+    }
+}
+
+void ShmClientIo::onStateChanged(QLocalSocket::LocalSocketState state)
+{
+    if (state == QLocalSocket::ClosingState && !isClosing()) {
+        m_channel->close();
+        m_socket->abort();
+        emit shouldReconnect(this);
+    }
+}
+
+ShmServerIo::ShmServerIo(QLocalSocket *conn, const QString &key, quint32 ringCapacity, QObject *parent)
+    : ServerIoDevice(parent)
+    , m_connection(conn)
+    , m_channel(new ShmChannel(conn, this))
+{
+    m_connection->setParent(this);
+    connect(m_channel, &QIODevice::readyRead, this, &ServerIoDevice::readyRead);
+    connect(conn, &QLocalSocket::disconnected, this, &ServerIoDevice::disconnected);
+    // Reported as a disconnect, once the owner is listening for it
+    if (!m_channel->createSegment(key, ringCapacity))
+        QMetaObject::invokeMethod(m_connection, &QLocalSocket::abort, Qt::QueuedConnection);
+}
+
+QIODevice *ShmServerIo::connection() const
+{
+    return m_channel;
+}
+
+void ShmServerIo::doClose()
+{
+    m_channel->close();
+    m_connection->disconnectFromServer();
+}
+
+ShmServerImpl::ShmServerImpl(QObject *parent)
+    : QConnectionAbstractServer(parent)
+    , m_ringCapacity(defaultRingCapacity)
+{
+    connect(&m_server, &QLocalServer::newConnection, this, &QConnectionAbstractServer::newConnection);
+}
+
+ShmServerImpl::~ShmServerImpl()
+{
+    m_server.close();
+}
+
+ServerIoDevice *ShmServerImpl::configureNewConnection()
+{
+    if (!m_server.isListening())
+        return nullptr;
+
+    // A new segment for every connection, so a reconnecting node never sees stale data
+    const QString key = QStringLiteral("qtro-shm-%1-%2-%3").arg(m_server.serverName())
+                                                         .arg(QCoreApplication::applicationPid())
+                                                         .arg(++m_lastSegment);
+    return new ShmServerIo(m_server.nextPendingConnection(), key, m_ringCapacity, this);
+}
+
+bool ShmServerImpl::hasPendingConnections() const
+{
+    return m_server.hasPendingConnections();
+}
+
+QUrl ShmServerImpl::address() const
+{
+    QUrl result;
+    result.setPath(m_server.serverName());
+    result.setScheme(QRemoteObjectStringLiterals::shm());
+
+    return result;
+}
+
+/*
+ * Every connection gets a segment with two rings of the capacity given by the
+ * ringSize query item of the address, rounded up to a power of two, e.g.
+ * "shm:service?ringSize=65536". The default is 1 MiB per ring.
+ */
+bool ShmServerImpl::listen(const QUrl &address)
+{
+    const QString ringSize = QUrlQuery(address).queryItemValue(QStringLiteral("ringSize"));
+    m_ringCapacity = defaultRingCapacity;
+    if (!ringSize.isEmpty()) {
+        bool ok;
+        const quint32 requested = ringSize.toUInt(&ok);
+        if (ok)
+            m_ringCapacity = qNextPowerOfTwo(qBound(minRingCapacity, requested, maxRingCapacity) - 1);
+        else
+            qCWarning(QT_REMOTEOBJECT) << "Invalid ringSize" << ringSize << "in" << address;
+    }
+#ifdef Q_OS_UNIX
+    bool res = m_server.listen(address.path());
+    if (!res) {
+        QLocalServer::removeServer(address.path());
+        res = m_server.listen(address.path());
+    }
+    return res;
+#else
+    return m_server.listen(address.path());
+#endif
+}
+
+QAbstractSocket::SocketError ShmServerImpl::serverError() const
+{
+    return m_server.serverError();
+}
+
+void ShmServerImpl::close()
+{
+    m_server.close();
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,198 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtRemoteObjects module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef QCONNECTIONSHMBACKEND_P_H
+#define QCONNECTIONSHMBACKEND_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qconnectionfactories_p.h"
+
+#include <QtCore/qsharedmemory.h>
+#include <QtNetwork/qlocalserver.h>
+#include <QtNetwork/qlocalsocket.h>
+
+QT_REQUIRE_CONFIG(sharedmemory);
+
+QT_BEGIN_NAMESPACE
+
+struct ShmRingHeader;
+
+/*
+ * One direction of a ShmChannel: a single producer, single consumer ring
+ * buffer in the shared memory segment.
+ */
+class ShmRing
+{
+public:
+    void reset(ShmRingHeader *header = nullptr, char *data = nullptr, quint32 capacity = 0);
+    ShmRingHeader *header() const { return m_header; }
+    quint32 used() const;
+    quint32 space() const;
+    quint32 write(const char *data, quint32 size);
+    quint32 read(char *data, quint32 size);
+
+private:
+    ShmRingHeader *m_header = nullptr;
+    char *m_data = nullptr;
+    quint32 m_capacity = 0;
+};
+
+/*
+ * The QIODevice the shm backend hands to IoDeviceBase. Data is passed
+ * through ring buffers in a shared memory segment created by the server
+ * end. The local socket of the connection only carries the segment's key
+ * and one byte doorbells, which are rung when a ring the peer waits on goes
+ * from empty to non-empty, or once there is space in a full one.
+ */
+class ShmChannel final : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    explicit ShmChannel(QLocalSocket *socket, QObject *parent = nullptr);
+    ~ShmChannel() override;
+
+    bool createSegment(const QString &key, quint32 ringCapacity);
+
+    bool isSequential() const override;
+    qint64 bytesAvailable() const override;
+    qint64 bytesToWrite() const override;
+    void close() override;
+
+Q_SIGNALS:
+    void attached();
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 size) override;
+
+private:
+    void onSocketReadyRead();
+    bool attachSegment();
+    void setupRings();
+    void notifyReader();
+    bool waitForDoorbell();
+    void writePending();
+    void wakeReader(quint32 previousHead);
+    void ringDoorbell(char doorbell);
+
+    QLocalSocket *m_socket;
+    QSharedMemory m_segment;
+    ShmRing m_rx;
+    ShmRing m_tx;
+    QByteArray m_pending; // written while m_tx was full
+    mutable quint32 m_seenHead = 0; // head of m_rx as of the last bytesAvailable() or read
+    bool m_serverEnd = false;
+};
+
+class ShmClientIo final : public ClientIoDevice
+{
+    Q_OBJECT
+
+public:
+    explicit ShmClientIo(QObject *parent = nullptr);
+    ~ShmClientIo() override;
+
+    QIODevice *connection() const override;
+    void connectToServer() override;
+    bool isOpen() const override;
+
+public Q_SLOTS:
+    void onError(QLocalSocket::LocalSocketError error);
+    void onStateChanged(QLocalSocket::LocalSocketState state);
+
+protected:
+    void doClose() override;
+    void doDisconnectFromServer() override;
+private:
+    QLocalSocket *m_socket;
+    ShmChannel *m_channel;
+};
+
+class ShmServerIo final : public ServerIoDevice
+{
+    Q_OBJECT
+public:
+    explicit ShmServerIo(QLocalSocket *conn, const QString &key, quint32 ringCapacity, QObject *parent = nullptr);
+
+    QIODevice *connection() const override;
+protected:
+    void doClose() override;
+
+private:
+    QLocalSocket *m_connection;
+    ShmChannel *m_channel;
+};
+
+class ShmServerImpl final : public QConnectionAbstractServer
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(ShmServerImpl)
+
+public:
+    explicit ShmServerImpl(QObject *parent);
+    ~ShmServerImpl() override;
+
+    bool hasPendingConnections() const override;
+    ServerIoDevice *configureNewConnection() override;
+    QUrl address() const override;
+    bool listen(const QUrl &address) override;
+    QAbstractSocket::SocketError serverError() const override;
+    void close() override;
+
+private:
+    QLocalServer m_server;
+    int m_lastSegment = 0;
+    quint32 m_ringCapacity;
+};
+
+QT_END_NAMESPACE
+
+#endif
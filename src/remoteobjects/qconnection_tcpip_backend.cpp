@@ -39,17 +39,92 @@
 
 #include "qconnection_tcpip_backend_p.h"
 
-#include <QtNetwork/qhostinfo.h>
+#include <QtCore/qdeadlinetimer.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qmutex.h>
 
 QT_BEGIN_NAMESPACE
 
+namespace {
+
+// QHostInfo doesn't report the TTL of the records, so resolved addresses are kept for a fixed
+// time, the same QHostInfo uses for its own cache
+constexpr int resolvedHostLifetime = 60 * 1000;
+// Delay before racing the next address, as recommended by RFC 8305 (Happy Eyeballs)
+constexpr int connectionAttemptDelay = 250;
+
+struct ResolvedHost
+{
+    QList<QHostAddress> addresses;
+    QDeadlineTimer expiry;
+};
+
+// Shared by the nodes of all threads
+struct ResolvedHostCache
+{
+    QMutex mutex;
+    QHash<QString, ResolvedHost> hosts;
+};
+
+Q_GLOBAL_STATIC(ResolvedHostCache, resolvedHostCache)
+
+QList<QHostAddress> cachedAddresses(const QString &hostName)
+{
+    ResolvedHostCache *cache = resolvedHostCache();
+    QMutexLocker locker(&cache->mutex);
+    auto it = cache->hosts.find(hostName);
+    if (it == cache->hosts.end())
+        return {};
+    if (it->expiry.hasExpired()) {
+        cache->hosts.erase(it);
+        return {};
+    }
+    return it->addresses;
+}
+
+void cacheAddresses(const QString &hostName, const QList<QHostAddress> &addresses)
+{
+    ResolvedHostCache *cache = resolvedHostCache();
+    QMutexLocker locker(&cache->mutex);
+    cache->hosts.insert(hostName, {addresses, QDeadlineTimer(resolvedHostLifetime)});
+}
+
+void dropCachedAddresses(const QString &hostName)
+{
+    ResolvedHostCache *cache = resolvedHostCache();
+    QMutexLocker locker(&cache->mutex);
+    cache->hosts.remove(hostName);
+}
+
+// Alternate between the address families, starting with the resolver's preferred one
+QList<QHostAddress> interleaveFamilies(const QList<QHostAddress> &addresses)
+{
+    QList<QHostAddress> preferred, other;
+    const QAbstractSocket::NetworkLayerProtocol family = addresses.constFirst().protocol();
+    for (const QHostAddress &address : addresses)
+        (address.protocol() == family ? preferred : other).append(address);
+
+    QList<QHostAddress> result;
+    result.reserve(addresses.size());
+    for (int i = 0; i < qMax(preferred.size(), other.size()); ++i) {
+        if (i < preferred.size())
+            result.append(preferred.at(i));
+        if (i < other.size())
+            result.append(other.at(i));
+    }
+    return result;
+}
+
+} // namespace
+
 TcpClientIo::TcpClientIo(QObject *parent)
     : ClientIoDevice(parent)
-    , m_socket(new QTcpSocket(this))
+    , m_socket(nullptr)
 {
-    connect(m_socket, &QTcpSocket::readyRead, this, &ClientIoDevice::readyRead);
-    connect(m_socket, &QAbstractSocket::errorOccurred, this, &TcpClientIo::onError);
-    connect(m_socket, &QTcpSocket::stateChanged, this, &TcpClientIo::onStateChanged);
+    setSocket(new QTcpSocket(this));
+    m_attemptTimer.setSingleShot(true);
+    m_attemptTimer.setInterval(connectionAttemptDelay);
+    connect(&m_attemptTimer, &QTimer::timeout, this, &TcpClientIo::connectNextAddress);
 }
 
 TcpClientIo::~TcpClientIo()
@@ -57,6 +132,14 @@ TcpClientIo::~TcpClientIo()
     close();
 }
 
+void TcpClientIo::setSocket(QTcpSocket *socket)
+{
+    m_socket = socket;
+    connect(m_socket, &QTcpSocket::readyRead, this, &ClientIoDevice::readyRead);
+    connect(m_socket, &QAbstractSocket::errorOccurred, this, &TcpClientIo::onError);
+    connect(m_socket, &QTcpSocket::stateChanged, this, &TcpClientIo::onStateChanged);
+}
+
 QIODevice *TcpClientIo::connection() const
 {
     return m_socket;
@@ -64,6 +147,11 @@ QIODevice *TcpClientIo::connection() const
 
 void TcpClientIo::doClose()
 {
+    if (m_lookupId != -1) {
+        QHostInfo::abortHostLookup(m_lookupId);
+        m_lookupId = -1;
+    }
+    adoptSocket(m_socket);
     if (m_socket->isOpen()) {
         connect(m_socket, &QTcpSocket::disconnected, this, &QObject::deleteLater);
         m_socket->disconnectFromHost();
@@ -81,20 +169,102 @@ void TcpClientIo::connectToServer()
 {
     if (isOpen())
         return;
-    QHostAddress address(url().host());
-    if (address.isNull()) {
-        const QList<QHostAddress> addresses = QHostInfo::fromName(url().host()).addresses();
-        Q_ASSERT_X(addresses.size() >= 1, Q_FUNC_INFO, url().toString().toLatin1().data());
-        address = addresses.first();
+    const QHostAddress address(url().host());
+    if (!address.isNull()) {
+        m_socket->connectToHost(address, url().port());
+        return;
     }
 
-    m_socket->connectToHost(address, url().port());
+    // Never block the node's thread on the resolver, reconnects would stall all its connections
+    const QList<QHostAddress> addresses = cachedAddresses(url().host());
+    if (!addresses.isEmpty())
+        startConnecting(addresses);
+    else
+        m_lookupId = QHostInfo::lookupHost(url().host(), this, &TcpClientIo::onHostFound);
 }
 
 bool TcpClientIo::isOpen() const
 {
     return (!isClosing() && (m_socket->state() == QAbstractSocket::ConnectedState
-                             || m_socket->state() == QAbstractSocket::ConnectingState));
+                             || m_socket->state() == QAbstractSocket::ConnectingState
+                             || m_lookupId != -1 || !m_attempts.isEmpty()));
+}
+
+void TcpClientIo::onHostFound(const QHostInfo &info)
+{
+    m_lookupId = -1;
+    if (isClosing())
+        return;
+    if (info.error() != QHostInfo::NoError || info.addresses().isEmpty()) {
+        qCDebug(QT_REMOTEOBJECT) << "Could not resolve" << url().host() << info.errorString();
+        emit shouldReconnect(this);
+        return;
+    }
+
+    cacheAddresses(url().host(), info.addresses());
+    startConnecting(info.addresses());
+}
+
+void TcpClientIo::startConnecting(const QList<QHostAddress> &addresses)
+{
+    m_addresses = interleaveFamilies(addresses);
+    m_socket->connectToHost(m_addresses.takeFirst(), url().port());
+    if (!m_addresses.isEmpty())
+        m_attemptTimer.start();
+}
+
+// Races another socket against the ones already connecting, the first to connect is kept
+void TcpClientIo::connectNextAddress()
+{
+    if (m_addresses.isEmpty())
+        return;
+
+    QTcpSocket *socket = new QTcpSocket(this);
+    m_attempts.append(socket);
+    connect(socket, &QAbstractSocket::connected, this, [this, socket]() { adoptSocket(socket); });
+    connect(socket, &QAbstractSocket::errorOccurred, this, [this, socket]() { onAttemptFailed(socket); });
+    socket->connectToHost(m_addresses.takeFirst(), url().port());
+    if (!m_addresses.isEmpty())
+        m_attemptTimer.start();
+}
+
+void TcpClientIo::onAttemptFailed(QTcpSocket *socket)
+{
+    m_attempts.removeOne(socket);
+    disconnect(socket, nullptr, this, nullptr);
+    socket->deleteLater();
+
+    if (!m_addresses.isEmpty()) {
+        m_attemptTimer.stop();
+        connectNextAddress();
+    } else if (m_attempts.isEmpty() && m_socket->state() == QAbstractSocket::UnconnectedState) {
+        // m_socket failed before, and didn't ask for a reconnect while we were still trying
+        dropCachedAddresses(url().host());
+        emit shouldReconnect(this);
+    }
+}
+
+// Stops all attempts but the one of socket, which becomes the connection
+void TcpClientIo::adoptSocket(QTcpSocket *socket)
+{
+    m_attemptTimer.stop();
+    m_addresses.clear();
+    for (QTcpSocket *attempt : qExchange(m_attempts, {})) {
+        disconnect(attempt, nullptr, this, nullptr);
+        if (attempt != socket) {
+            attempt->abort();
+            attempt->deleteLater();
+        }
+    }
+    if (socket == m_socket)
+        return;
+
+    // Nothing is written before the connection is established, so the socket can be replaced
+    disconnect(m_socket, nullptr, this, nullptr);
+    m_socket->abort();
+    m_socket->deleteLater();
+    setSocket(socket);
+    onStateChanged(QAbstractSocket::ConnectedState);
 }
 
 void TcpClientIo::onError(QAbstractSocket::SocketError error)
@@ -105,6 +275,16 @@ void TcpClientIo::onError(QAbstractSocket::SocketError error)
     case QAbstractSocket::HostNotFoundError:     //Host not there, wait and try again
     case QAbstractSocket::ConnectionRefusedError:
     case QAbstractSocket::NetworkError:
+        if (!m_attempts.isEmpty() || !m_addresses.isEmpty()) {
+            // Other addresses of the host are tried, onAttemptFailed reports if all fail
+            if (!m_addresses.isEmpty()) {
+                m_attemptTimer.stop();
+                connectNextAddress();
+            }
+            break;
+        }
+        if (QHostAddress(url().host()).isNull())
+            dropCachedAddresses(url().host());
         emit shouldReconnect(this);
         break;
     case QAbstractSocket::AddressInUseError:
@@ -121,8 +301,10 @@ void TcpClientIo::onStateChanged(QAbstractSocket::SocketState state)
         m_socket->abort();
         emit shouldReconnect(this);
     }
-    if (state == QAbstractSocket::ConnectedState)
+    if (state == QAbstractSocket::ConnectedState) {
+        adoptSocket(m_socket);
         initializeDataStream();
+    }
 }
 
 
@@ -144,6 +326,11 @@ void TcpServerIo::doClose()
     m_connection->disconnectFromHost();
 }
 
+QIODevice *TcpServerIo::takeConnection()
+{
+    return qExchange(m_connection, nullptr);
+}
+
 
 
 TcpServerImpl::TcpServerImpl(QObject *parent)
@@ -53,6 +53,8 @@
 
 #include "qconnectionfactories_p.h"
 
+#include <QtCore/qtimer.h>
+#include <QtNetwork/qhostinfo.h>
 #include <QtNetwork/qtcpserver.h>
 #include <QtNetwork/qtcpsocket.h>
 
@@ -79,7 +81,19 @@ protected:
     void doDisconnectFromServer() override;
 
 private:
+    void setSocket(QTcpSocket *socket);
+    void onHostFound(const QHostInfo &info);
+    void startConnecting(const QList<QHostAddress> &addresses);
+    void connectNextAddress();
+    void onAttemptFailed(QTcpSocket *socket);
+    void adoptSocket(QTcpSocket *socket);
+
     QTcpSocket *m_socket;
+    // While connecting to a host name, addresses not tried yet and the sockets racing m_socket
+    QList<QHostAddress> m_addresses;
+    QVector<QTcpSocket *> m_attempts;
+    QTimer m_attemptTimer;
+    int m_lookupId = -1;
 };
 
 class TcpServerIo final : public ServerIoDevice
@@ -91,6 +105,7 @@ public:
     QIODevice *connection() const override;
 protected:
     void doClose() override;
+    QIODevice *takeConnection() override;
 
 private:
     QTcpSocket *m_connection;
@@ -45,9 +45,18 @@
 #include "qconnection_qnx_backend_p.h"
 #endif
 #include "qconnection_local_backend_p.h"
+#if QT_CONFIG(sharedmemory)
+#include "qconnection_shm_backend_p.h"
+#endif
 #include "qconnection_tcpip_backend_p.h"
 // END: Backends
 
+#include <QtCore/qendian.h>
+#include <QtCore/qvarlengtharray.h>
+#include <QtNetwork/qlocalsocket.h>
+
+#include <limits>
+
 QT_BEGIN_NAMESPACE
 
 using namespace QtRemoteObjects;
@@ -61,10 +70,15 @@ public:
 
 Q_GLOBAL_STATIC(QtROFactoryLoader, loader)
 
-inline bool fromDataStream(QDataStream &in, QRemoteObjectPacketTypeEnum &type, QString &name)
+// Room reserved in front of coalesced packets, to turn them into a Batch packet
+static const int batchHeaderSize = int(sizeof(quint32) + sizeof(quint16));
+
+inline bool fromDataStream(QDataStream &in, QRemoteObjectPacketTypeEnum &type, bool &hasObjectId)
 {
     quint16 _type;
     in >> _type;
+    hasObjectId = _type & objectIdFlag;
+    _type &= ~objectIdFlag;
     type = Invalid;
     switch (_type) {
     case Handshake: type = Handshake; break;
@@ -78,16 +92,16 @@ inline bool fromDataStream(QDataStream &in, QRemoteObjectPacketTypeEnum &type, Q
     case ObjectList: type = ObjectList; break;
     case Ping: type = Ping; break;
     case Pong: type = Pong; break;
+    case Batch: type = Batch; break;
+    case InitDeltaPacket: type = InitDeltaPacket; break;
+    case CompactPropertyChangePacket: type = CompactPropertyChangePacket; break;
+    case CompressedBatch: type = CompressedBatch; break;
+    case InvokeBatchPacket: type = InvokeBatchPacket; break;
+    case InvokeBatchReplyPacket: type = InvokeBatchReplyPacket; break;
     default:
         qCWarning(QT_REMOTEOBJECT_IO) << "Invalid packet received" << _type;
     }
-    if (type == Invalid)
-        return false;
-    if (type == ObjectList)
-        return true;
-    in >> name;
-    qCDebug(QT_REMOTEOBJECT_IO) << "Packet received of type" << type << "for object" << name;
-    return true;
+    return type != Invalid;
 }
 
 /*!
@@ -95,10 +109,39 @@ inline bool fromDataStream(QDataStream &in, QRemoteObjectPacketTypeEnum &type, Q
     an associated QDataStream to handle marshalling of Qt types. IoDeviceBase
     is an abstract base class that provides a consistent interface to QtRO, yet
     can be extended to support different types of QIODevice.
+
+    Packets are only handed out once they have been received completely, and
+    stream() then reads from a copy of that single packet. This means a packet
+    can be dropped without decoding its payload, e.g. if the object it is meant
+    for no longer exists.
+
+    Writes are coalesced and handed to the device once per event loop
+    iteration, or as soon as maxWriteBatchSize bytes are pending. If the peer
+    supports it (see setLegacyProtocol()), the coalesced packets are sent as
+    a single Batch packet, which read() unpacks again transparently. Once a
+    compression threshold was negotiated, pending data of at least that size
+    is sent as CompressedBatch packets instead, if qCompress() makes it
+    smaller. Each of them inflates to no more than maxCompressedBatchSize
+    bytes, larger CompressedBatch packets are rejected by read(). Larger
+    pending data is cut into several of them, so a packet of up to
+    maxSplitPacketSize bytes can continue in the next CompressedBatch, and
+    read() joins it again.
+
+    Packets written with writeConflated() replace any earlier packet for the
+    same object and property that has not been handed to the device yet. They
+    are held back as long as the device still has unwritten data, so a slow
+    peer only ever receives the latest value instead of a growing backlog.
  */
 IoDeviceBase::IoDeviceBase(QObject *parent)
-    : QObject(parent), m_isClosing(false), m_curReadSize(0)
+    : QObject(parent), m_isClosing(false), m_curReadSize(0), m_batchPos(0), m_batchEnd(0), m_packetEnd(0)
+    , m_inflatedBatch(false)
+    , m_bufferedPackets(0), m_flushScheduled(false), m_legacyProtocol(true), m_compressionThreshold(0)
+    , m_watchingBytesWritten(false), m_highWatermark(0), m_lowWatermark(0)
+    , m_sendQueuePolicy(QRemoteObjectHostBase::DropOldestPackets), m_congested(false)
 {
+    m_frameBuffer.setBuffer(&m_frame);
+    m_frameBuffer.open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    m_dataStream.setDevice(&m_frameBuffer);
     m_dataStream.setVersion(dataStreamVersion);
 }
 
@@ -107,51 +150,574 @@ IoDeviceBase::~IoDeviceBase()
 }
 
 bool IoDeviceBase::read(QRemoteObjectPacketTypeEnum &type, QString &name)
+{
+    quint32 objectId;
+    return read(type, name, objectId);
+}
+
+/*!
+    Reads the header of the next packet, if it is complete. Init packets from
+    a host may announce a numeric id for the object, which is bound on this
+    connection until a RemoveObject for the same object is seen. Later packets
+    can then carry the id instead of the full object name, and \a name is
+    resolved from the id. \a objectId is 0 for packets that carry the name.
+ */
+bool IoDeviceBase::read(QRemoteObjectPacketTypeEnum &type, QString &name, quint32 &objectId)
 {
     qCDebug(QT_REMOTEOBJECT_IO) << deviceType() << "read()" << m_curReadSize << bytesAvailable();
 
-    if (m_curReadSize == 0) {
-        if (bytesAvailable() < static_cast<int>(sizeof(quint32)))
+    const bool batched = m_batchEnd > 0;
+    if (batched) {
+        m_frameBuffer.seek(m_batchPos);
+        m_dataStream.resetStatus();
+        quint32 size = 0;
+        const bool complete = m_batchEnd - m_batchPos >= int(sizeof(quint32));
+        if (complete)
+            m_dataStream >> size;
+        const int start = m_batchPos + int(sizeof(quint32));
+        if (!complete || size > quint32(m_batchEnd - start)) {
+            if (m_inflatedBatch && size <= quint32(maxSplitPacketSize)) {
+                // The rest of the packet follows in the next CompressedBatch
+                m_partialPacket = m_frame.mid(m_batchPos, m_batchEnd - m_batchPos);
+                m_batchPos = m_batchEnd = 0;
+                return read(type, name, objectId);
+            }
+            qCWarning(QT_REMOTEOBJECT_IO) << "Malformed Batch packet received";
+            m_batchPos = m_batchEnd = 0;
             return false;
+        }
+        m_batchPos = m_packetEnd = start + int(size);
+        if (m_batchPos == m_batchEnd)
+            m_batchPos = m_batchEnd = 0;
+    } else {
+        if (m_curReadSize == 0) {
+            if (device()->bytesAvailable() < static_cast<int>(sizeof(quint32)))
+                return false;
 
-        m_dataStream >> m_curReadSize;
-    }
+            quint32 size;
+            device()->read(reinterpret_cast<char *>(&size), sizeof(size));
+            m_curReadSize = qFromBigEndian(size);
+        }
 
-    qCDebug(QT_REMOTEOBJECT_IO) << deviceType() << "read()-looking for map" << m_curReadSize << bytesAvailable();
+        qCDebug(QT_REMOTEOBJECT_IO) << deviceType() << "read()-looking for map" << m_curReadSize << bytesAvailable();
 
-    if (bytesAvailable() < m_curReadSize)
+        if (device()->bytesAvailable() < m_curReadSize)
+            return false;
+
+        m_frame.resize(int(m_curReadSize));
+        device()->read(m_frame.data(), m_curReadSize);
+        m_packetEnd = m_frame.size();
+        m_frameBuffer.seek(0);
+        m_dataStream.resetStatus();
+        m_curReadSize = 0;
+        m_receivedSinceHeartbeat = true;
+    }
+    objectId = 0;
+    bool hasObjectId;
+    if (!fromDataStream(m_dataStream, type, hasObjectId))
+        return false;
+    if (!m_partialPacket.isEmpty() && type != CompressedBatch) {
+        qCWarning(QT_REMOTEOBJECT_IO) << "Incomplete packet at the end of a CompressedBatch received";
+        m_partialPacket.clear();
         return false;
+    }
+    if (type == Batch || type == CompressedBatch) {
+        if (batched) {
+            qCWarning(QT_REMOTEOBJECT_IO) << "Nested Batch packet received";
+            m_batchPos = m_batchEnd = 0;
+            return false;
+        }
+        m_batchPos = int(m_frameBuffer.pos());
+        if (type == CompressedBatch) {
+            // qCompress() prefixes the inflated size, check it before qUncompress() allocates
+            const int compressedSize = m_frame.size() - m_batchPos;
+            if (compressedSize < int(sizeof(quint32))
+                    || qFromBigEndian<quint32>(m_frame.constData() + m_batchPos) > quint32(maxCompressedBatchSize)) {
+                qCWarning(QT_REMOTEOBJECT_IO) << "Oversized or malformed CompressedBatch packet received";
+                m_batchPos = m_batchEnd = 0;
+                return false;
+            }
+            QByteArray inflated = qUncompress(reinterpret_cast<const uchar *>(m_frame.constData()) + m_batchPos,
+                                              m_frame.size() - m_batchPos);
+            if (inflated.isEmpty()) {
+                qCWarning(QT_REMOTEOBJECT_IO) << "Malformed CompressedBatch packet received";
+                m_batchPos = m_batchEnd = 0;
+                return false;
+            }
+            if (!m_partialPacket.isEmpty()) {
+                inflated.prepend(m_partialPacket);
+                m_partialPacket.clear();
+            }
+            m_frame.swap(inflated);
+            m_batchPos = 0;
+        }
+        m_inflatedBatch = type == CompressedBatch;
+        m_batchEnd = m_frame.size();
+        if (m_batchPos == m_batchEnd) {
+            m_batchPos = m_batchEnd = 0;
+            return false;
+        }
+        return read(type, name, objectId);
+    }
+    if (type == ObjectList)
+        return true;
 
-    m_curReadSize = 0;
-    return fromDataStream(m_dataStream, type, name);
+    if (hasObjectId && type != InitPacket && type != InitDynamicPacket && type != InitDeltaPacket) {
+        readVarint(m_dataStream, objectId);
+        name = m_objectNames.value(int(qMin(objectId, maxObjectId + 1)));
+        if (name.isEmpty())
+            qCDebug(QT_REMOTEOBJECT_IO) << deviceType() << "Packet received for unknown object id" << objectId;
+    } else {
+        m_dataStream >> name;
+        if (hasObjectId) {
+            readVarint(m_dataStream, objectId);
+            bindObjectId(objectId, name);
+        } else if (type == RemoveObject) {
+            releaseObjectId(name);
+        }
+    }
+    qCDebug(QT_REMOTEOBJECT_IO) << "Packet received of type" << type << "for object" << name << objectId;
+    return true;
 }
 
 void IoDeviceBase::write(const QByteArray &data)
 {
-    if (connection()->isOpen() && !m_isClosing)
-        connection()->write(data);
+    write(data, data.size());
 }
 
 void IoDeviceBase::write(const QByteArray &data, qint64 size)
 {
-    if (connection()->isOpen() && !m_isClosing)
-        connection()->write(data.data(), size);
+    if (!device()->isOpen() || m_isClosing)
+        return;
+
+    // Keep the order of packets, unless the device is still busy
+    if (!m_conflatedSlots.isEmpty() && device()->bytesToWrite() == 0)
+        appendConflated();
+
+    // Leave room for the Batch header, which is filled in by flush() if needed
+    if (m_writeBuffer.isEmpty())
+        m_writeBuffer.fill('\0', batchHeaderSize);
+    m_writeBuffer.append(data.constData(), int(size));
+    ++m_bufferedPackets;
+
+    if (m_writeBuffer.size() >= maxWriteBatchSize) {
+        flush();
+    } else if (!m_flushScheduled) {
+        m_flushScheduled = true;
+        QMetaObject::invokeMethod(this, [this]() { flush(); }, Qt::QueuedConnection);
+    }
+}
+
+/*!
+    Writes a packet about the object \a name. Property changes of that object
+    still waiting in the conflation queue are queued before it, so the peer
+    never sees a signal or reply ahead of the property values that were
+    current when it was sent.
+ */
+void IoDeviceBase::write(const QByteArray &data, qint64 size, const QString &name)
+{
+    if (m_conflatedObjects.contains(name))
+        appendConflated(name);
+    write(data, size);
+}
+
+void IoDeviceBase::writeConflated(const QByteArray &data, qint64 size, const QString &name, int index)
+{
+    if (!device()->isOpen() || m_isClosing)
+        return;
+
+    watchBytesWritten();
+
+    const QPair<QString, int> key(name, index);
+    const auto it = m_conflatedSlots.constFind(key);
+    if (it != m_conflatedSlots.cend()) {
+        m_conflatedPackets[*it].data = data.left(int(size));
+        return;
+    }
+    m_conflatedSlots.insert(key, m_conflatedPackets.size());
+    m_conflatedPackets.append({name, index, data.left(int(size))});
+    m_conflatedObjects.insert(name);
+    if (!m_flushScheduled) {
+        m_flushScheduled = true;
+        QMetaObject::invokeMethod(this, [this]() { flush(); }, Qt::QueuedConnection);
+    }
+}
+
+void IoDeviceBase::appendConflated()
+{
+    if (m_writeBuffer.isEmpty())
+        m_writeBuffer.fill('\0', batchHeaderSize);
+    for (const ConflatedPacket &packet : qAsConst(m_conflatedPackets)) {
+        m_writeBuffer.append(packet.data);
+        ++m_bufferedPackets;
+    }
+    m_conflatedPackets.clear();
+    m_conflatedSlots.clear();
+    m_conflatedObjects.clear();
+}
+
+// Moves the conflated property changes of one object to the write buffer, in the order they were
+// first queued. The entries of other objects move up, so the queue never holds flushed entries.
+void IoDeviceBase::appendConflated(const QString &name)
+{
+    if (m_writeBuffer.isEmpty())
+        m_writeBuffer.fill('\0', batchHeaderSize);
+    int kept = 0;
+    for (int i = 0; i < m_conflatedPackets.size(); ++i) {
+        ConflatedPacket &packet = m_conflatedPackets[i];
+        if (packet.name == name) {
+            m_writeBuffer.append(packet.data);
+            ++m_bufferedPackets;
+            m_conflatedSlots.remove(qMakePair(packet.name, packet.index));
+            continue;
+        }
+        if (kept != i) {
+            m_conflatedSlots[qMakePair(packet.name, packet.index)] = kept;
+            m_conflatedPackets[kept] = std::move(packet);
+        }
+        ++kept;
+    }
+    m_conflatedPackets.resize(kept);
+    m_conflatedObjects.remove(name);
+}
+
+void IoDeviceBase::watchBytesWritten()
+{
+    if (m_watchingBytesWritten)
+        return;
+    m_watchingBytesWritten = true;
+    connect(device(), &QIODevice::bytesWritten, this, &IoDeviceBase::onBytesWritten);
+}
+
+void IoDeviceBase::onBytesWritten()
+{
+    if (m_congested)
+        checkSendQueue();
+    else if (!m_conflatedSlots.isEmpty() && device()->bytesToWrite() == 0)
+        flush();
+}
+
+/*!
+    Hands all pending packets to the device. This happens automatically, but
+    can be called to avoid waiting for the next event loop iteration.
+ */
+void IoDeviceBase::flush()
+{
+    m_flushScheduled = false;
+    if (!m_conflatedSlots.isEmpty() && device()->bytesToWrite() == 0)
+        appendConflated();
+
+    // While the send queue is over its high watermark, packets wait in m_writeBuffer
+    if (!m_writeBuffer.isEmpty() && !m_congested) {
+        if (device()->isOpen() && !m_isClosing) {
+            if (writeCompressed()) {
+                // handed to the device as a CompressedBatch
+            } else if (!m_legacyProtocol && m_bufferedPackets > 1) {
+                qToBigEndian(quint32(m_writeBuffer.size() - sizeof(quint32)), m_writeBuffer.data());
+                qToBigEndian(quint16(Batch), m_writeBuffer.data() + sizeof(quint32));
+                // Not write(m_writeBuffer), the device could share it and make the reuse below detach
+                device()->write(m_writeBuffer.constData(), m_writeBuffer.size());
+            } else {
+                device()->write(m_writeBuffer.constData() + batchHeaderSize, m_writeBuffer.size() - batchHeaderSize);
+            }
+        }
+        releaseWriteBuffer();
+        m_bufferedPackets = 0;
+    }
+    checkSendQueue();
+}
+
+// Empties the write buffer, but keeps its memory for the next batch unless a large
+// payload made it grow well beyond the usual batch size
+void IoDeviceBase::releaseWriteBuffer()
+{
+    if (m_writeBuffer.capacity() > 2 * maxWriteBatchSize)
+        m_writeBuffer.clear();
+    else
+        m_writeBuffer.resize(0);
+}
+
+// Returns false if the pending packets are better sent uncompressed
+bool IoDeviceBase::writeCompressed()
+{
+    const int payloadSize = m_writeBuffer.size() - batchHeaderSize;
+    if (!m_compressionThreshold || payloadSize < m_compressionThreshold || payloadSize > maxSplitPacketSize)
+        return false;
+
+    // Cut at maxCompressedBatchSize regardless of packet boundaries, read() joins split packets again
+    const uchar *payload = reinterpret_cast<const uchar *>(m_writeBuffer.constData()) + batchHeaderSize;
+    QVarLengthArray<QByteArray, 1> chunks;
+    int compressedSize = 0;
+    for (int pos = 0; pos < payloadSize; pos += maxCompressedBatchSize) {
+        chunks.append(qCompress(payload + pos, qMin(payloadSize - pos, maxCompressedBatchSize)));
+        compressedSize += batchHeaderSize + chunks.last().size();
+    }
+    if (compressedSize >= m_writeBuffer.size())
+        return false;
+
+    for (const QByteArray &chunk : qAsConst(chunks)) {
+        char header[batchHeaderSize];
+        qToBigEndian(quint32(chunk.size() + sizeof(quint16)), header);
+        qToBigEndian(quint16(CompressedBatch), header + sizeof(quint32));
+        device()->write(header, batchHeaderSize);
+        device()->write(chunk);
+    }
+    qCDebug(QT_REMOTEOBJECT_IO) << deviceType() << "Compressed" << payloadSize << "bytes to" << compressedSize
+                                << "in" << chunks.size() << "CompressedBatch packets";
+    return true;
+}
+
+/*!
+    Bounds the data queued for this connection. Once more than \a highWatermark
+    bytes are queued (in the device and here), sendQueueHighWatermarkReached()
+    is emitted and packets are no longer handed to the device until its backlog
+    went down to \a lowWatermark, when sendQueueLowWatermarkReached() is
+    emitted. While held back, property changes are conflated or the oldest
+    signals and superseded property changes are dropped, depending on \a
+    policy. The other policies are implemented by the owner of the connection.
+
+    Only dropping bounds what is held back. With the other policies, packets
+    written while congested keep waiting here, so once they exceed
+    heldBackWatermarks times \a highWatermark, sendQueueOverflowed() is
+    emitted and the owner is expected to close the connection.
+
+    A \a highWatermark of 0 disables the limits.
+ */
+void IoDeviceBase::setSendQueueLimits(qint64 highWatermark, qint64 lowWatermark, QRemoteObjectHostBase::SendQueuePolicy policy)
+{
+    m_highWatermark = qMax(highWatermark, qint64(0));
+    m_lowWatermark = qBound(qint64(0), lowWatermark, m_highWatermark);
+    m_sendQueuePolicy = policy;
+    if (m_highWatermark)
+        watchBytesWritten();
+    checkSendQueue();
+}
+
+qint64 IoDeviceBase::queuedBytes() const
+{
+    qint64 queued = device()->bytesToWrite();
+    if (!m_writeBuffer.isEmpty())
+        queued += m_writeBuffer.size() - batchHeaderSize;
+    for (const ConflatedPacket &packet : m_conflatedPackets)
+        queued += packet.data.size();
+    return queued;
+}
+
+void IoDeviceBase::checkSendQueue()
+{
+    if (!m_congested) {
+        if (!m_highWatermark)
+            return;
+        const qint64 queued = queuedBytes();
+        if (queued <= m_highWatermark)
+            return;
+        m_congested = true;
+        emit sendQueueHighWatermarkReached(queued);
+    } else if (!m_highWatermark || device()->bytesToWrite() <= m_lowWatermark) {
+        m_congested = false;
+        emit sendQueueLowWatermarkReached(queuedBytes());
+        if (!m_flushScheduled && (!m_writeBuffer.isEmpty() || !m_conflatedSlots.isEmpty())) {
+            m_flushScheduled = true;
+            QMetaObject::invokeMethod(this, [this]() { flush(); }, Qt::QueuedConnection);
+        }
+        return;
+    }
+
+    if (m_sendQueuePolicy == QRemoteObjectHostBase::DropOldestPackets) {
+        if (queuedBytes() > m_highWatermark)
+            dropOldestPackets();
+        return;
+    }
+    // Only what waits here counts, the device's backlog is bounded by the peer reading it
+    qint64 heldBack = m_writeBuffer.isEmpty() ? 0 : m_writeBuffer.size() - batchHeaderSize;
+    for (const ConflatedPacket &packet : qAsConst(m_conflatedPackets))
+        heldBack += packet.data.size();
+    if (heldBack > heldBackWatermarks * m_highWatermark && !m_isClosing)
+        emit sendQueueOverflowed(heldBack);
+}
+
+// For PropertyChange and CompactPropertyChange packets, the bytes addressing the object and the
+// property, which are the same for every change of that property. Empty for other packets.
+static QByteArray propertyKey(const char *packet, int packetSize)
+{
+    const quint16 rawType = qFromBigEndian<quint16>(packet + sizeof(quint32));
+    const quint16 type = rawType & ~objectIdFlag;
+    if (type != PropertyChangePacket && type != CompactPropertyChangePacket)
+        return QByteArray();
+
+    const auto skipVarint = [packet, packetSize](qint64 pos) {
+        while (pos < packetSize && (packet[pos] & 0x80))
+            ++pos;
+        return pos + 1;
+    };
+    const int headerSize = int(sizeof(quint32) + sizeof(quint16));
+    qint64 pos = headerSize;
+    if (rawType & objectIdFlag) {
+        pos = skipVarint(pos);
+    } else {
+        if (pos + qint64(sizeof(quint32)) > packetSize)
+            return QByteArray();
+        const quint32 nameSize = qFromBigEndian<quint32>(packet + pos);
+        pos += sizeof(quint32);
+        if (nameSize != 0xFFFFFFFF)
+            pos += nameSize;
+    }
+    pos = type == PropertyChangePacket ? pos + qint64(sizeof(qint32)) : skipVarint(pos);
+    if (pos > packetSize)
+        return QByteArray();
+    return QByteArray(packet + headerSize, int(pos - headerSize));
+}
+
+/*
+    Signals are dropped oldest first, until the queue is back at the low
+    watermark. A property change is only dropped if a newer value of the same
+    property is queued after it, together with the notify signal that follows
+    it, so replicas still end up with the latest value of every property.
+    Anything else would break the replicas.
+ */
+void IoDeviceBase::dropOldestPackets()
+{
+    struct QueuedPacket
+    {
+        int pos;
+        int size;
+        quint16 type;
+        QByteArray propertyKey;
+    };
+    QVector<QueuedPacket> packets;
+    QHash<QByteArray, int> newestChanges; // index of the newest change of each property
+    for (int pos = batchHeaderSize; pos < m_writeBuffer.size();) {
+        const char *packet = m_writeBuffer.constData() + pos;
+        const int packetSize = int(sizeof(quint32) + qFromBigEndian<quint32>(packet));
+        const quint16 type = qFromBigEndian<quint16>(packet + sizeof(quint32)) & ~objectIdFlag;
+        const QByteArray key = propertyKey(packet, packetSize);
+        if (!key.isEmpty())
+            newestChanges.insert(key, packets.size());
+        packets.append({pos, packetSize, type, key});
+        pos += packetSize;
+    }
+
+    qint64 excess = queuedBytes() - m_lowWatermark;
+    QByteArray kept;
+    kept.reserve(m_writeBuffer.size());
+    kept.append(m_writeBuffer.constData(), batchHeaderSize);
+    int keptPackets = 0;
+    int dropped = 0;
+    bool afterPropertyChange = false;
+    bool previousDropped = false;
+    for (int i = 0; i < packets.size(); ++i) {
+        const QueuedPacket &packet = packets.at(i);
+        bool drop = false;
+        if (!packet.propertyKey.isEmpty())
+            drop = newestChanges.value(packet.propertyKey) != i;
+        else if (packet.type == InvokePacket)
+            drop = afterPropertyChange ? previousDropped : excess > 0;
+        afterPropertyChange = !packet.propertyKey.isEmpty();
+        previousDropped = drop;
+        if (drop) {
+            excess -= packet.size;
+            ++dropped;
+        } else {
+            kept.append(m_writeBuffer.constData() + packet.pos, packet.size);
+            ++keptPackets;
+        }
+    }
+    if (!dropped)
+        return;
+
+    if (keptPackets)
+        m_writeBuffer.swap(kept);
+    else
+        releaseWriteBuffer();
+    m_bufferedPackets = keptPackets;
+    qCDebug(QT_REMOTEOBJECT_IO) << deviceType() << "Dropped" << dropped << "packets, send queue is full";
+    emit packetsDropped(dropped);
 }
 
 void IoDeviceBase::close()
 {
+    if (!m_conflatedSlots.isEmpty())
+        appendConflated();
+    flush();
     m_isClosing = true;
-    doClose();
+    if (m_relay)
+        m_relay->close();
+    else
+        doClose();
+}
+
+/*!
+    Moves the socket of this connection to \a thread, where it is read and
+    written from then on. The received data is split into packets there, so
+    this object only gets to see whole packets. Encoding and decoding them
+    stays on the thread of this object: decoding resolves object ids and names
+    bound on this connection and creates the values with the types of the
+    node, and CompressedBatch packets are inflated by read(), which enforces
+    their bounds and joins packets split across them.
+
+    This has to be called before anything is written. Only sockets (TCP and
+    local) of connections that implement takeConnection() can be moved. The
+    relay takes over closing them, and connection() no longer returns them, so
+    nothing on this thread can touch the socket anymore. Returns \c false if
+    the connection stays on the current thread.
+ */
+bool IoDeviceBase::setIoThread(QThread *thread)
+{
+    QIODevice *socket = connection();
+    if (m_relay || !thread || !socket
+            || !(qobject_cast<QAbstractSocket *>(socket) || qobject_cast<QLocalSocket *>(socket)))
+        return false;
+    socket = takeConnection();
+    if (!socket)
+        return false;
+
+    disconnect(socket, &QIODevice::readyRead, this, nullptr);
+    m_relay = new IoThreadRelay(socket, thread, this);
+    connect(m_relay, &QIODevice::readyRead, this, &IoDeviceBase::readyRead);
+    return true;
+}
+
+/*!
+    Returns true if waitForReadyRead() can block on the socket of this
+    connection. It can't if the socket is served by an I/O thread or is not a
+    QAbstractSocket or QLocalSocket, or when called from another thread.
+ */
+bool IoDeviceBase::canWaitForReadyRead() const
+{
+    QIODevice *socket = connection();
+    return !m_relay && socket && thread() == QThread::currentThread()
+            && (qobject_cast<QAbstractSocket *>(socket) || qobject_cast<QLocalSocket *>(socket));
+}
+
+/*!
+    Sends the pending packets, then blocks until more data arrived or \a
+    deadline expired, without running an event loop. The data is dispatched in
+    place, by the readyRead() signal the socket emits. Returns false if nothing
+    was read, because of the deadline, an error or canWaitForReadyRead() being
+    false.
+ */
+bool IoDeviceBase::waitForReadyRead(QDeadlineTimer deadline)
+{
+    if (!canWaitForReadyRead() || m_isClosing)
+        return false;
+
+    flush();
+    const qint64 remaining = deadline.remainingTime();
+    if (remaining == 0)
+        return false;
+    return connection()->waitForReadyRead(int(qMin<qint64>(remaining, std::numeric_limits<int>::max())));
 }
 
 qint64 IoDeviceBase::bytesAvailable() const
 {
-    return connection()->bytesAvailable();
+    return device()->bytesAvailable() + (m_batchEnd - m_batchPos);
 }
 
 void IoDeviceBase::initializeDataStream()
 {
-    m_dataStream.setDevice(connection());
+    m_curReadSize = 0;
+    m_batchPos = m_batchEnd = m_packetEnd = 0;
+    m_partialPacket.clear();
     m_dataStream.resetStatus();
 }
 
@@ -170,6 +736,163 @@ QSet<QString> IoDeviceBase::remoteObjects() const
     return m_remoteObjects;
 }
 
+void IoDeviceBase::bindObjectId(quint32 id, const QString &name)
+{
+    releaseObjectId(name);
+    if (id == 0 || id > maxObjectId)
+        return;
+    if (m_objectNames.size() <= int(id))
+        m_objectNames.resize(id + 1);
+    m_objectNames[id] = name;
+    m_objectIds.insert(name, id);
+}
+
+void IoDeviceBase::releaseObjectId(const QString &name)
+{
+    const quint32 id = m_objectIds.take(name);
+    if (id)
+        m_objectNames[id].clear();
+}
+
+IoThreadRelay::IoThreadRelay(QIODevice *device, QThread *thread, QObject *parent)
+    : QIODevice(parent)
+    , m_device(device)
+{
+    open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+    m_device->setParent(nullptr);
+    m_device->moveToThread(thread);
+    // The device is the context, so these run on the I/O thread
+    connect(m_device, &QIODevice::readyRead, m_device, [this]() { receive(); });
+    connect(m_device, &QIODevice::bytesWritten, m_device, [this](qint64 bytes) { onBytesWritten(bytes); });
+    // Picks up anything that arrived before the move
+    QMetaObject::invokeMethod(m_device, [this]() { receive(); }, Qt::QueuedConnection);
+}
+
+IoThreadRelay::~IoThreadRelay()
+{
+    // Runs after everything already queued for the device, which may still use this relay
+    QIODevice *device = m_device;
+    auto release = [device]() { delete device; };
+    if (device->thread()->isRunning())
+        QMetaObject::invokeMethod(device, release, Qt::BlockingQueuedConnection);
+    else
+        release();
+}
+
+qint64 IoThreadRelay::bytesAvailable() const
+{
+    return QIODevice::bytesAvailable() + m_readBuffer.size() - m_readPos;
+}
+
+qint64 IoThreadRelay::bytesToWrite() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_unwritten;
+}
+
+void IoThreadRelay::close()
+{
+    QIODevice::close();
+    QIODevice *device = m_device;
+    QMetaObject::invokeMethod(device, [device]() { device->close(); }, Qt::QueuedConnection);
+}
+
+qint64 IoThreadRelay::readData(char *data, qint64 maxSize)
+{
+    const int count = int(qMin(maxSize, qint64(m_readBuffer.size() - m_readPos)));
+    memcpy(data, m_readBuffer.constData() + m_readPos, size_t(count));
+    m_readPos += count;
+    if (m_readPos == m_readBuffer.size()) {
+        m_readBuffer.clear();
+        m_readPos = 0;
+    }
+    return count;
+}
+
+qint64 IoThreadRelay::writeData(const char *data, qint64 size)
+{
+    QMutexLocker locker(&m_mutex);
+    m_toSend.append(data, int(size));
+    m_unwritten += size;
+    if (!m_sendScheduled) {
+        m_sendScheduled = true;
+        locker.unlock();
+        QMetaObject::invokeMethod(m_device, [this]() { send(); }, Qt::QueuedConnection);
+    }
+    return size;
+}
+
+void IoThreadRelay::receive()
+{
+    const QByteArray data = m_device->readAll();
+    if (data.isEmpty())
+        return;
+    m_assembling.append(data);
+    // Every packet starts with its size, see IoDeviceBase::read()
+    qint64 complete = 0;
+    while (m_assembling.size() - complete >= qint64(sizeof(quint32))) {
+        const qint64 end = complete + qint64(sizeof(quint32))
+                + qFromBigEndian<quint32>(m_assembling.constData() + complete);
+        if (end > m_assembling.size())
+            break;
+        complete = end;
+    }
+    if (!complete)
+        return;
+    QByteArray packets;
+    if (complete == m_assembling.size()) {
+        packets.swap(m_assembling);
+    } else {
+        packets = m_assembling.left(int(complete));
+        m_assembling.remove(0, int(complete));
+    }
+    QMutexLocker locker(&m_mutex);
+    m_received.append(packets);
+    if (!m_receiveNotified) {
+        m_receiveNotified = true;
+        locker.unlock();
+        QMetaObject::invokeMethod(this, &IoThreadRelay::takeReceived, Qt::QueuedConnection);
+    }
+}
+
+void IoThreadRelay::send()
+{
+    QByteArray data;
+    {
+        QMutexLocker locker(&m_mutex);
+        data.swap(m_toSend);
+        m_sendScheduled = false;
+    }
+    if (m_device->isOpen())
+        m_device->write(data);
+}
+
+void IoThreadRelay::onBytesWritten(qint64 bytes)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_unwritten = qMax(m_unwritten - bytes, qint64(0));
+    }
+    QMetaObject::invokeMethod(this, [this, bytes]() { emit bytesWritten(bytes); }, Qt::QueuedConnection);
+}
+
+void IoThreadRelay::takeReceived()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_receiveNotified = false;
+        if (m_readBuffer.isEmpty()) {
+            m_readBuffer.swap(m_received);
+        } else {
+            m_readBuffer.remove(0, m_readPos);
+            m_readPos = 0;
+            m_readBuffer.append(m_received);
+            m_received.clear();
+        }
+    }
+    emit readyRead();
+}
+
 ClientIoDevice::ClientIoDevice(QObject *parent) : IoDeviceBase(parent)
 {
 }
@@ -272,6 +995,9 @@ QtROServerFactory::QtROServerFactory()
     registerType<QnxServerImpl>(QStringLiteral("qnx"));
 #endif
     registerType<LocalServerImpl>(QStringLiteral("local"));
+#if QT_CONFIG(sharedmemory)
+    registerType<ShmServerImpl>(QStringLiteral("shm"));
+#endif
     registerType<TcpServerImpl>(QStringLiteral("tcp"));
 }
 
@@ -291,6 +1017,9 @@ QtROClientFactory::QtROClientFactory()
     registerType<QnxClientIo>(QStringLiteral("qnx"));
 #endif
     registerType<LocalClientIo>(QStringLiteral("local"));
+#if QT_CONFIG(sharedmemory)
+    registerType<ShmClientIo>(QStringLiteral("shm"));
+#endif
     registerType<TcpClientIo>(QStringLiteral("tcp"));
 }
 
@@ -52,21 +52,150 @@
 //
 
 #include <QtNetwork/qabstractsocket.h>
+#include <QtCore/qbuffer.h>
 #include <QtCore/qdatastream.h>
+#include <QtCore/qdeadlinetimer.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qpair.h>
 #include <QtCore/qiodevice.h>
+#include <QtCore/qmutex.h>
 #include <QtCore/qpointer.h>
+#include <QtCore/qthread.h>
+#include <QtCore/qvector.h>
 
 #include <QtRemoteObjects/qtremoteobjectglobal.h>
+#include <QtRemoteObjects/qremoteobjectnode.h>
 
 QT_BEGIN_NAMESPACE
 
 namespace QtRemoteObjects {
 
 static const int dataStreamVersion = QDataStream::Qt_5_12;
-static const QLatin1String protocolVersion("QtRO 1.3");
+static const QLatin1String protocolVersion("QtRO 1.4");
+// Hosts speaking the previous revision never assign object ids, but are otherwise compatible
+static const QLatin1String legacyProtocolVersion("QtRO 1.3");
+
+// Set on the packet type when the object is referenced by its numeric id rather than its name
+static const quint16 objectIdFlag = 0x8000;
+static const quint32 maxObjectId = 0xFFFF;
+// Packets written within one event loop iteration are coalesced, up to this many bytes
+static const int maxWriteBatchSize = 64 * 1024;
+// While congested, at most this many high watermarks of packets are held back, see checkSendQueue()
+static const int heldBackWatermarks = 4;
+// A CompressedBatch never inflates to more than this, larger batches are sent as several of them
+static const int maxCompressedBatchSize = 16 * maxWriteBatchSize;
+// A packet may span consecutive CompressedBatch packets up to this size, larger ones are sent uncompressed
+static const int maxSplitPacketSize = 64 * maxCompressedBatchSize;
+
+// Capabilities announced after the protocol version in Handshake packets
+enum ProtocolCapability : quint32 {
+    CompressionCapability = 0x1
+};
+
+inline void writeVarint(QDataStream &ds, quint32 value)
+{
+    while (value >= 0x80) {
+        ds << quint8((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    ds << quint8(value);
+}
 
+inline void readVarint(QDataStream &ds, quint32 &value)
+{
+    value = 0;
+    quint8 byte = 0x80;
+    for (int shift = 0; shift < 35 && (byte & 0x80); shift += 7) {
+        ds >> byte;
+        value |= quint32(byte & 0x7F) << shift;
+    }
+}
+
+inline void writeVarint64(QDataStream &ds, quint64 value)
+{
+    while (value >= 0x80) {
+        ds << quint8((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    ds << quint8(value);
 }
 
+inline void readVarint64(QDataStream &ds, quint64 &value)
+{
+    value = 0;
+    quint8 byte = 0x80;
+    for (int shift = 0; shift < 70 && (byte & 0x80); shift += 7) {
+        ds >> byte;
+        value |= quint64(byte & 0x7F) << shift;
+    }
+}
+
+}
+
+/*
+ * Runs the sockets of connections that were handed to it with
+ * IoDeviceBase::setIoThread().
+ */
+class IoThread final : public QThread
+{
+public:
+    explicit IoThread(QObject *parent = nullptr) : QThread(parent)
+    {
+        setObjectName(QStringLiteral("QtRO I/O"));
+    }
+    ~IoThread() override
+    {
+        quit();
+        wait();
+    }
+};
+
+/*
+ * Stands in for a socket that was moved to an IoThread. It lives on the
+ * thread of the IoDeviceBase, which reads and writes it like the socket
+ * itself. Data is exchanged with the socket's thread in chunks, under a
+ * mutex that is only held to append or swap them. Received data is split
+ * into packets on the socket's thread, so only whole packets are handed
+ * over and the IoDeviceBase is never woken for a partial one.
+ */
+class IoThreadRelay final : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    IoThreadRelay(QIODevice *device, QThread *thread, QObject *parent = nullptr);
+    ~IoThreadRelay() override;
+
+    bool isSequential() const override { return true; }
+    QThread *deviceThread() const { return m_device->thread(); }
+    qint64 bytesAvailable() const override;
+    qint64 bytesToWrite() const override;
+    void close() override;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 size) override;
+
+private:
+    // Called on the I/O thread
+    void receive();
+    void send();
+    void onBytesWritten(qint64 bytes);
+    // Called on the thread of the relay
+    void takeReceived();
+
+    QIODevice *m_device; // lives on the I/O thread
+    QByteArray m_assembling; // only used on the I/O thread, starts with an incomplete packet
+    mutable QMutex m_mutex;
+    QByteArray m_received; // guarded by m_mutex, like the three below
+    QByteArray m_toSend;
+    qint64 m_unwritten = 0;
+    bool m_receiveNotified = false;
+    bool m_sendScheduled = false;
+    QByteArray m_readBuffer;
+    int m_readPos = 0;
+};
+
 class Q_REMOTEOBJECTS_EXPORT IoDeviceBase : public QObject
 {
     Q_OBJECT
@@ -77,33 +206,119 @@ public:
     ~IoDeviceBase() override;
 
     bool read(QtRemoteObjects::QRemoteObjectPacketTypeEnum &, QString &);
+    bool read(QtRemoteObjects::QRemoteObjectPacketTypeEnum &, QString &, quint32 &objectId);
 
     virtual void write(const QByteArray &data);
     virtual void write(const QByteArray &data, qint64);
+    void write(const QByteArray &data, qint64 size, const QString &name);
+    void writeConflated(const QByteArray &data, qint64 size, const QString &name, int index);
+    void flush();
+    // Stays true until the handshake showed the peer speaks the current protocol revision
+    void setLegacyProtocol(bool legacy) { m_legacyProtocol = legacy; }
+    bool isLegacyProtocol() const { return m_legacyProtocol; }
+    // Only set once the handshake showed the peer accepts CompressedBatch packets
+    void setCompressionThreshold(int bytes) { m_compressionThreshold = qMax(bytes, 0); }
+    int compressionThreshold() const { return m_compressionThreshold; }
+    void setSendQueueLimits(qint64 highWatermark, qint64 lowWatermark, QRemoteObjectHostBase::SendQueuePolicy policy);
+    qint64 queuedBytes() const;
+    bool isCongested() const { return m_congested; }
+    bool setIoThread(QThread *thread);
+    // The thread the socket is read and written on
+    QThread *ioThread() const { return m_relay ? m_relay->deviceThread() : thread(); }
+    bool canWaitForReadyRead() const;
+    bool waitForReadyRead(QDeadlineTimer deadline);
+    // For the node's heartbeat: whether a packet arrived since the last call, and whether a Ping awaits its Pong
+    bool takeReceivedSinceHeartbeat() { return qExchange(m_receivedSinceHeartbeat, false); }
+    void setHeartbeatPending(bool pending) { m_heartbeatPending = pending; }
+    bool isHeartbeatPending() const { return m_heartbeatPending; }
+    bool conflatesPropertyChanges() const
+    {
+        return m_congested && m_sendQueuePolicy == QRemoteObjectHostBase::ConflatePropertyChanges;
+    }
+    // Sources skip this connection while it is suspended, and resend what changed once it drained
+    bool isSuspended() const
+    {
+        return m_congested && m_sendQueuePolicy == QRemoteObjectHostBase::SuspendClient;
+    }
     virtual bool isOpen() const { return !isClosing(); }
     virtual void close();
     virtual qint64 bytesAvailable() const;
     virtual QIODevice *connection() const = 0;
     void initializeDataStream();
     QDataStream& stream() { return m_dataStream; }
+    // Position in stream()'s device where the current packet ends, a Batch holds more packets after it
+    qint64 packetEnd() const { return m_packetEnd; }
     inline bool isClosing() const { return m_isClosing; }
     void addSource(const QString &);
     void removeSource(const QString &);
     QSet<QString> remoteObjects() const;
+    void bindObjectId(quint32 id, const QString &name);
+    void releaseObjectId(const QString &name);
+    quint32 objectId(const QString &name) const { return m_objectIds.value(name); }
 
 Q_SIGNALS:
     void readyRead();
     void disconnected();
+    void sendQueueHighWatermarkReached(qint64 queuedBytes);
+    void sendQueueLowWatermarkReached(qint64 queuedBytes);
+    void packetsDropped(int count);
+    void sendQueueOverflowed(qint64 heldBackBytes);
 
 protected:
     virtual QString deviceType() const = 0;
     virtual void doClose() = 0;
+    // Hands the socket over to setIoThread(), connection() returns nullptr from then on
+    virtual QIODevice *takeConnection() { return nullptr; }
     bool m_isClosing;
 
 private:
+    // The device actually read and written, connection() unless it was moved to an I/O thread
+    QIODevice *device() const { return m_relay ? static_cast<QIODevice *>(m_relay) : connection(); }
+    void appendConflated();
+    void appendConflated(const QString &name);
+    void releaseWriteBuffer();
+    bool writeCompressed();
+    void onBytesWritten();
+    void watchBytesWritten();
+    void checkSendQueue();
+    void dropOldestPackets();
+
     quint32 m_curReadSize;
+    QByteArray m_frame; // reused for every packet, only grows
+    QBuffer m_frameBuffer;
     QDataStream m_dataStream;
+    int m_batchPos; // position of the next packet in m_frame, if it holds a Batch
+    int m_batchEnd;
+    int m_packetEnd; // end of the current packet in m_frame
+    bool m_inflatedBatch; // m_frame holds a CompressedBatch, which can end within a packet
+    QByteArray m_partialPacket; // start of a packet continued in the next CompressedBatch
+    QByteArray m_writeBuffer;
+    int m_bufferedPackets;
+    bool m_flushScheduled;
+    bool m_legacyProtocol;
+    int m_compressionThreshold; // 0 means nothing is compressed
+    // Property changes waiting for the device to drain, at most one per (object, property),
+    // in the order they were first queued
+    struct ConflatedPacket
+    {
+        QString name;
+        int index;
+        QByteArray data;
+    };
+    QVector<ConflatedPacket> m_conflatedPackets;
+    QHash<QPair<QString, int>, int> m_conflatedSlots; // index into m_conflatedPackets
+    QSet<QString> m_conflatedObjects; // with entries in m_conflatedSlots
+    bool m_watchingBytesWritten;
+    qint64 m_highWatermark; // 0 means the send queue isn't bounded
+    qint64 m_lowWatermark;
+    QRemoteObjectHostBase::SendQueuePolicy m_sendQueuePolicy;
+    bool m_congested;
+    IoThreadRelay *m_relay = nullptr;
+    bool m_receivedSinceHeartbeat = false;
+    bool m_heartbeatPending = false;
     QSet<QString> m_remoteObjects;
+    QVector<QString> m_objectNames; // indexed by object id, 0 is never assigned
+    QHash<QString, quint32> m_objectIds;
 };
 
 class Q_REMOTEOBJECTS_EXPORT ServerIoDevice : public IoDeviceBase
@@ -41,8 +41,37 @@
 
 #include <QtCore/qitemselectionmodel.h>
 
-// consider evaluating performance difference with item data
-inline QVariantList collectData(const QModelIndex &index, const QAbstractItemModel *model, const QVector<int> &roles)
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+inline RoleDataBuffer roleDataBuffer(const QVector<int> &roles)
+{
+    RoleDataBuffer roleData;
+    roleData.reserve(roles.size());
+    for (int role : roles)
+        roleData.push_back(QModelRoleData(role));
+    return roleData;
+}
+
+// Asks the model for all roles of the cell at once, so models and proxies that
+// implement multiData() resolve the index a single time instead of once per role.
+// The buffer is reused for every cell of a request.
+inline QVariantList collectData(const QModelIndex &index, const QAbstractItemModel *model, RoleDataBuffer &roleData)
+{
+    for (QModelRoleData &entry : roleData)
+        entry.clearData();
+    model->multiData(index, QModelRoleDataSpan(roleData));
+    QVariantList result;
+    result.reserve(roleData.size());
+    for (QModelRoleData &entry : roleData)
+        result << std::move(entry.data());
+    return result;
+}
+#else
+inline RoleDataBuffer roleDataBuffer(const QVector<int> &roles)
+{
+    return roles;
+}
+
+inline QVariantList collectData(const QModelIndex &index, const QAbstractItemModel *model, RoleDataBuffer &roles)
 {
     QVariantList result;
     result.reserve(roles.size());
@@ -50,6 +79,7 @@ inline QVariantList collectData(const QModelIndex &index, const QAbstractItemMod
         result << model->data(index, role);
     return result;
 }
+#endif
 
 inline QVector<int> filterRoles(const QVector<int> &roles, const QVector<int> &availableRoles)
 {
@@ -158,12 +188,13 @@ DataEntries QAbstractItemModelSourceAdapter::replicaRowRequest(IndexList start,
     Q_ASSERT_X(endRow >= 0 && endRow < rowCount, __FUNCTION__, qPrintable(QString(QLatin1String("0 <= %1 < %2")).arg(endRow).arg(rowCount)));
     Q_ASSERT_X(endColumn >= 0 && endColumn < columnCount, __FUNCTION__, qPrintable(QString(QLatin1String("0 <= %1 < %2")).arg(endColumn).arg(columnCount)));
 
+    RoleDataBuffer roleData = roleDataBuffer(roles);
     for (int row = startRow; row <= endRow; ++row) {
         for (int column = startColumn; column <= endColumn; ++column) {
             const QModelIndex current = m_model->index(row, column, parent);
             Q_ASSERT(current.isValid());
             const IndexList currentList = toModelIndexList(current, m_model);
-            const QVariantList data = collectData(current, m_model, roles);
+            const QVariantList data = collectData(current, m_model, roleData);
             const bool hasChildren = m_model->hasChildren(current);
             const Qt::ItemFlags flags = m_model->flags(current);
             qCDebug(QT_REMOTEOBJECT_MODELS) << Q_FUNC_INFO << "current=" << currentList << "data=" << data;
@@ -177,7 +208,8 @@ MetaAndDataEntries QAbstractItemModelSourceAdapter::replicaCacheRequest(size_t s
 {
     MetaAndDataEntries res;
     res.roles = roles.isEmpty() ? m_availableRoles : roles;
-    res.data = fetchTree(QModelIndex{}, size, roles);
+    RoleDataBuffer roleData = roleDataBuffer(res.roles);
+    res.data = fetchTree(QModelIndex{}, size, roleData);
     const int rowCount = m_model->rowCount(QModelIndex{});
     const int columnCount = m_model->columnCount(QModelIndex{});
     res.size = QSize{columnCount, rowCount};
@@ -202,7 +234,7 @@ void QAbstractItemModelSourceAdapter::replicaSetCurrentIndex(IndexList index, QI
         m_selectionModel->setCurrentIndex(toQModelIndex(index, m_model), command);
 }
 
-void QAbstractItemModelSourceAdapter::sourceDataChanged(const QModelIndex & topLeft, const QModelIndex & bottomRight, const QVector<int> & roles) const
+void QAbstractItemModelSourceAdapter::sourceDataChanged(const QModelIndex & topLeft, const QModelIndex & bottomRight, const QVector<int> & roles)
 {
     QVector<int> neededRoles = filterRoles(roles, availableRoles());
     if (neededRoles.isEmpty()) {
@@ -214,6 +246,14 @@ void QAbstractItemModelSourceAdapter::sourceDataChanged(const QModelIndex & topL
     IndexList start = toModelIndexList(topLeft, m_model);
     IndexList end = toModelIndexList(bottomRight, m_model);
     qCDebug(QT_REMOTEOBJECT_MODELS) << Q_FUNC_INFO << "start=" << start << "end=" << end << "neededRoles=" << neededRoles;
+    // Sending the new values of small ranges saves the replicas from fetching them again
+    if (m_inlineDataLimit > 0) {
+        const qint64 cells = qint64(bottomRight.row() - topLeft.row() + 1) * (bottomRight.column() - topLeft.column() + 1);
+        if (cells <= m_inlineDataLimit) {
+            emit dataChangedWithValues(start, end, neededRoles, replicaRowRequest(start, end, neededRoles));
+            return;
+        }
+    }
     emit dataChanged(start, end, neededRoles);
 }
 
@@ -248,7 +288,7 @@ void QAbstractItemModelSourceAdapter::sourceCurrentChanged(const QModelIndex & c
     emit currentChanged(currentIndex, previousIndex);
 }
 
-QVector<IndexValuePair> QAbstractItemModelSourceAdapter::fetchTree(const QModelIndex &parent, size_t &size, const QVector<int> &roles)
+QVector<IndexValuePair> QAbstractItemModelSourceAdapter::fetchTree(const QModelIndex &parent, size_t &size, RoleDataBuffer &roleData)
 {
     QVector<IndexValuePair> entries;
     const int rowCount = m_model->rowCount(parent);
@@ -260,7 +300,7 @@ QVector<IndexValuePair> QAbstractItemModelSourceAdapter::fetchTree(const QModelI
         for (int column = 0; column < columnCount && size > 0; ++column) {
             const auto index = m_model->index(row, column, parent);
             const IndexList currentList = toModelIndexList(index, m_model);
-            const QVariantList data = collectData(index, m_model, roles);
+            const QVariantList data = collectData(index, m_model, roleData);
             const bool hasChildren = m_model->hasChildren(index);
             const Qt::ItemFlags flags = m_model->flags(index);
             int rc = m_model->rowCount(index);
@@ -268,7 +308,7 @@ QVector<IndexValuePair> QAbstractItemModelSourceAdapter::fetchTree(const QModelI
             IndexValuePair rowData(currentList, data, hasChildren, flags, QSize{cc, rc});
             --size;
             if (hasChildren)
-                rowData.children = fetchTree(index, size, roles);
+                rowData.children = fetchTree(index, size, roleData);
             entries.push_back(rowData);
         }
     return entries;
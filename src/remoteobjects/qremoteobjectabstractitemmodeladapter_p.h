@@ -61,6 +61,14 @@ QT_BEGIN_NAMESPACE
 class QAbstractItemModel;
 class QItemSelectionModel;
 
+// QAbstractItemModel::multiData() and QModelRoleData only exist since Qt 6.0,
+// older Qt asks the model for one role at a time
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+typedef QVector<QModelRoleData> RoleDataBuffer;
+#else
+typedef QVector<int> RoleDataBuffer;
+#endif
+
 class QAbstractItemModelSourceAdapter : public QObject
 {
     Q_OBJECT
@@ -71,6 +79,9 @@ public:
     static void registerTypes();
     QItemSelectionModel* selectionModel() const;
 
+    int inlineDataLimit() const { return m_inlineDataLimit; }
+    void setInlineDataLimit(int cells) { m_inlineDataLimit = qMax(cells, 0); }
+
 public Q_SLOTS:
     QVector<int> availableRoles() const { return m_availableRoles; }
     void setAvailableRoles(QVector<int> availableRoles)
@@ -91,7 +102,7 @@ public Q_SLOTS:
     void replicaSetData(const IndexList &index, const QVariant &value, int role);
     MetaAndDataEntries replicaCacheRequest(size_t size, const QVector<int> &roles);
 
-    void sourceDataChanged(const QModelIndex & topLeft, const QModelIndex & bottomRight, const QVector<int> & roles = QVector<int> ()) const;
+    void sourceDataChanged(const QModelIndex & topLeft, const QModelIndex & bottomRight, const QVector<int> & roles = QVector<int> ());
     void sourceRowsInserted(const QModelIndex & parent, int start, int end);
     void sourceColumnsInserted(const QModelIndex & parent, int start, int end);
     void sourceRowsRemoved(const QModelIndex & parent, int start, int end);
@@ -106,14 +117,16 @@ Q_SIGNALS:
     void rowsMoved(IndexList sourceParent, int sourceRow, int count, IndexList destinationParent, int destinationChild) const;
     void currentChanged(IndexList current, IndexList previous);
     void columnsInserted(IndexList parent, int start, int end) const;
+    void dataChangedWithValues(IndexList topLeft, IndexList bottomRight, QVector<int> roles, DataEntries entries) const;
 
 private:
     QAbstractItemModelSourceAdapter();
-    QVector<IndexValuePair> fetchTree(const QModelIndex &parent, size_t &size, const QVector<int> &roles);
+    QVector<IndexValuePair> fetchTree(const QModelIndex &parent, size_t &size, RoleDataBuffer &roleData);
 
     QAbstractItemModel *m_model;
     QItemSelectionModel *m_selectionModel;
     QVector<int> m_availableRoles;
+    int m_inlineDataLimit = 0;
 };
 
 template <class ObjectType, class AdapterType>
@@ -128,7 +141,7 @@ struct QAbstractItemAdapterSourceAPI : public SourceApiMap
         m_properties[0] = 2;
         m_properties[1] = QtPrivate::qtro_property_index<AdapterType>(&AdapterType::availableRoles, static_cast<QVector<int> (QObject::*)()>(0),"availableRoles");
         m_properties[2] = QtPrivate::qtro_property_index<AdapterType>(&AdapterType::roleNames, static_cast<QIntHash (QObject::*)()>(0),"roleNames");
-        m_signals[0] = 9;
+        m_signals[0] = 10;
         m_signals[1] = QtPrivate::qtro_signal_index<AdapterType>(&AdapterType::availableRolesChanged, static_cast<void (QObject::*)()>(0),m_signalArgCount+0,&m_signalArgTypes[0]);
         m_signals[2] = QtPrivate::qtro_signal_index<AdapterType>(&AdapterType::dataChanged, static_cast<void (QObject::*)(IndexList,IndexList,QVector<int>)>(0),m_signalArgCount+1,&m_signalArgTypes[1]);
         m_signals[3] = QtPrivate::qtro_signal_index<AdapterType>(&AdapterType::rowsInserted, static_cast<void (QObject::*)(IndexList,int,int)>(0),m_signalArgCount+2,&m_signalArgTypes[2]);
@@ -138,6 +151,7 @@ struct QAbstractItemAdapterSourceAPI : public SourceApiMap
         m_signals[7] = QtPrivate::qtro_signal_index<ObjectType>(&ObjectType::modelReset, static_cast<void (QObject::*)()>(0),m_signalArgCount+6,&m_signalArgTypes[6]);
         m_signals[8] = QtPrivate::qtro_signal_index<ObjectType>(&ObjectType::headerDataChanged, static_cast<void (QObject::*)(Qt::Orientation,int,int)>(0),m_signalArgCount+7,&m_signalArgTypes[7]);
         m_signals[9] = QtPrivate::qtro_signal_index<AdapterType>(&AdapterType::columnsInserted, static_cast<void (QObject::*)(IndexList,int,int)>(0),m_signalArgCount+8,&m_signalArgTypes[8]);
+        m_signals[10] = QtPrivate::qtro_signal_index<AdapterType>(&AdapterType::dataChangedWithValues, static_cast<void (QObject::*)(IndexList,IndexList,QVector<int>,DataEntries)>(0),m_signalArgCount+9,&m_signalArgTypes[9]);
         m_methods[0] = 6;
         m_methods[1] = QtPrivate::qtro_method_index<AdapterType>(&AdapterType::replicaSizeRequest, static_cast<void (QObject::*)(IndexList)>(0),"replicaSizeRequest(IndexList)",m_methodArgCount+0,&m_methodArgTypes[0]);
         m_methods[2] = QtPrivate::qtro_method_index<AdapterType>(&AdapterType::replicaRowRequest, static_cast<void (QObject::*)(IndexList,IndexList,QVector<int>)>(0),"replicaRowRequest(IndexList,IndexList,QVector<int>)",m_methodArgCount+1,&m_methodArgTypes[1]);
@@ -213,6 +227,7 @@ struct QAbstractItemAdapterSourceAPI : public SourceApiMap
         case 6: return QByteArrayLiteral("resetModel()");
         case 7: return QByteArrayLiteral("headerDataChanged(Qt::Orientation,int,int)");
         case 8: return QByteArrayLiteral("columnsInserted(IndexList,int,int)");
+        case 9: return QByteArrayLiteral("dataChangedWithValues(IndexList,IndexList,QVector<int>,DataEntries)");
         }
         return QByteArrayLiteral("");
     }
@@ -264,6 +279,7 @@ struct QAbstractItemAdapterSourceAPI : public SourceApiMap
         case 4:
         case 5:
         case 8:
+        case 9:
             return true;
         }
         return false;
@@ -292,10 +308,10 @@ struct QAbstractItemAdapterSourceAPI : public SourceApiMap
     }
 
     int m_properties[3];
-    int m_signals[10];
+    int m_signals[11];
     int m_methods[7];
-    int m_signalArgCount[9];
-    const int* m_signalArgTypes[9];
+    int m_signalArgCount[10];
+    const int* m_signalArgTypes[10];
     int m_methodArgCount[6];
     const int* m_methodArgTypes[6];
     QString m_name;
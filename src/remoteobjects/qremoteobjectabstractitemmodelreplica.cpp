@@ -78,6 +78,9 @@ QAbstractItemModelReplicaImplementation::QAbstractItemModelReplicaImplementation
     initializeModelConnections();
     connect(this, &QAbstractItemModelReplicaImplementation::availableRolesChanged, this, [this]{
         m_availableRoles.clear();
+        // The cached values are stored by the index of their role
+        m_roleSlots.clear();
+        m_rootItem.clearValues();
     });
 }
 
@@ -91,6 +94,9 @@ QAbstractItemModelReplicaImplementation::QAbstractItemModelReplicaImplementation
     initializeNode(node, name);
     connect(this, &QAbstractItemModelReplicaImplementation::availableRolesChanged, this, [this]{
         m_availableRoles.clear();
+        // The cached values are stored by the index of their role
+        m_roleSlots.clear();
+        m_rootItem.clearValues();
     });
 }
 
@@ -134,6 +140,7 @@ void QAbstractItemModelReplicaImplementation::registerMetatypes()
 void QAbstractItemModelReplicaImplementation::initializeModelConnections()
 {
     connect(this, &QAbstractItemModelReplicaImplementation::dataChanged, this, &QAbstractItemModelReplicaImplementation::onDataChanged);
+    connect(this, &QAbstractItemModelReplicaImplementation::dataChangedWithValues, this, &QAbstractItemModelReplicaImplementation::onDataChangedWithValues);
     connect(this, &QAbstractItemModelReplicaImplementation::rowsInserted, this, &QAbstractItemModelReplicaImplementation::onRowsInserted);
     connect(this, &QAbstractItemModelReplicaImplementation::columnsInserted, this, &QAbstractItemModelReplicaImplementation::onColumnsInserted);
     connect(this, &QAbstractItemModelReplicaImplementation::rowsRemoved, this, &QAbstractItemModelReplicaImplementation::onRowsRemoved);
@@ -143,20 +150,36 @@ void QAbstractItemModelReplicaImplementation::initializeModelConnections()
     connect(this, &QAbstractItemModelReplicaImplementation::headerDataChanged, this, &QAbstractItemModelReplicaImplementation::onHeaderDataChanged);
 }
 
-inline void removeIndexFromRow(const QModelIndex &index, const QVector<int> &roles, CachedRowEntry *entry)
+inline void removeIndexFromRow(const QModelIndex &index, const QVector<int> &roles, CachedRowEntry *entry, const QAbstractItemModelReplicaImplementation *replica)
 {
     CachedRowEntry &entryRef = *entry;
     if (index.column() < entryRef.size()) {
-        CacheEntry &entry = entryRef[index.column()];
         if (roles.isEmpty()) {
-            entry.data.clear();
+            entryRef.clearValues(index.column());
         } else {
-            for (int role : roles)
-                entry.data.remove(role);
+            for (int role : roles) {
+                const int slot = replica->roleSlot(role);
+                if (slot >= 0)
+                    entryRef.clearValue(index.column(), slot);
+            }
         }
     }
 }
 
+void QAbstractItemModelReplicaImplementation::updateRoleSlots() const
+{
+    m_roleSlots.clear();
+    if (m_availableRoles.isEmpty())
+        return;
+    // A table indexed by role, unless the roles are too far apart for that
+    const int maxRole = *std::max_element(m_availableRoles.cbegin(), m_availableRoles.cend());
+    if (maxRole > 4 * Qt::UserRole || *std::min_element(m_availableRoles.cbegin(), m_availableRoles.cend()) < 0)
+        return;
+    m_roleSlots.fill(-1, maxRole + 1);
+    for (int i = m_availableRoles.size() - 1; i >= 0; --i)
+        m_roleSlots[m_availableRoles.at(i)] = i;
+}
+
 void QAbstractItemModelReplicaImplementation::onReplicaCurrentChanged(const QModelIndex &current, const QModelIndex &previous)
 {
     Q_UNUSED(previous)
@@ -201,7 +224,7 @@ bool QAbstractItemModelReplicaImplementation::clearCache(const IndexList &start,
         if (item) {
             CachedRowEntry *entry = &(item->cachedRowEntry);
             for (int column = startColumn; column <= lastColumn; ++column)
-                removeIndexFromRow(q->index(row, column, parentIndex), roles, entry);
+                removeIndexFromRow(q->index(row, column, parentIndex), roles, entry, this);
         }
     }
     return true;
@@ -316,24 +339,41 @@ void QAbstractItemModelReplicaImplementation::onRowsRemoved(const IndexList &par
     q->endRemoveRows();
 }
 
-void QAbstractItemModelReplicaImplementation::onRowsMoved(IndexList srcParent, int srcRow, int count, IndexList destParent, int destRow)
+void QAbstractItemModelReplicaImplementation::onRowsMoved(IndexList srcParent, int srcRow, int srcEnd, IndexList destParent, int destRow)
 {
-    qCDebug(QT_REMOTEOBJECT_MODELS) << Q_FUNC_INFO;
+    qCDebug(QT_REMOTEOBJECT_MODELS) << Q_FUNC_INFO << "start=" << srcRow << "end=" << srcEnd << "parent=" << srcParent
+                                    << "destination=" << destParent << "row=" << destRow;
+
+    bool sourceLoaded = true;
+    bool destinationLoaded = true;
+    const QModelIndex sourceParent = toQModelIndex(srcParent, q, &sourceLoaded);
+    const QModelIndex destinationParent = toQModelIndex(destParent, q, &destinationLoaded);
+    // A parent that was never fetched has nothing to update, only the other side sees a change
+    if (!sourceLoaded || !destinationLoaded) {
+        if (sourceLoaded)
+            onRowsRemoved(srcParent, srcRow, srcEnd);
+        else if (destinationLoaded)
+            onRowsInserted(destParent, destRow, destRow + srcEnd - srcRow);
+        return;
+    }
 
-    const QModelIndex sourceParent = toQModelIndex(srcParent, q);
-    const QModelIndex destinationParent = toQModelIndex(destParent, q);
-    Q_ASSERT(!sourceParent.isValid());
-    Q_ASSERT(!destinationParent.isValid());
-    q->beginMoveRows(sourceParent, srcRow, count, destinationParent, destRow);
-//TODO misses parents...
-    IndexList start, end;
-    start << ModelIndex(srcRow, 0);
-    end << ModelIndex(srcRow + count, q->columnCount(sourceParent)-1);
-    clearCache(start, end);
-    IndexList start2, end2;
-    start2 << ModelIndex(destRow, 0);
-    end2 << ModelIndex(destRow + count, q->columnCount(destinationParent)-1);
-    clearCache(start2, end2);
+    if (!q->beginMoveRows(sourceParent, srcRow, srcEnd, destinationParent, destRow)) {
+        onRowsRemoved(srcParent, srcRow, srcEnd);
+        onRowsInserted(destParent, destRow, destRow + srcEnd - srcRow);
+        return;
+    }
+    // Null if the parent was dropped from the cache meanwhile
+    CacheData *sourceItem = cacheData(sourceParent);
+    CacheData *destinationItem = cacheData(destinationParent);
+    if (sourceItem && sourceItem == destinationItem) {
+        sourceItem->moveChildren(srcRow, srcEnd, destRow);
+    } else {
+        // The moved rows are fetched again under their new parent
+        if (sourceItem)
+            sourceItem->removeChildren(srcRow, srcEnd);
+        if (destinationItem)
+            destinationItem->insertChildren(destRow, destRow + srcEnd - srcRow);
+    }
     q->endMoveRows();
 }
 
@@ -384,14 +424,14 @@ void QAbstractItemModelReplicaImplementation::handleModelResetDone(QRemoteObject
     m_headerData[0].resize(size.width());
     m_headerData[1].resize(size.height());
     {
-        QVector<CacheEntry> &headerEntries = m_headerData[0];
+        QVector<QHash<int, QVariant>> &headerEntries = m_headerData[0];
         for (int i = 0; i < size.width(); ++i )
-            headerEntries[i].data.clear();
+            headerEntries[i].clear();
     }
     {
-        QVector<CacheEntry> &headerEntries = m_headerData[1];
+        QVector<QHash<int, QVariant>> &headerEntries = m_headerData[1];
         for (int i = 0; i < size.height(); ++i )
-            headerEntries[i].data.clear();
+            headerEntries[i].clear();
     }
     if (m_initialAction == QtRemoteObjects::PrefetchData) {
         auto entries = watcher->returnValue().value<MetaAndDataEntries>();
@@ -448,6 +488,9 @@ QRemoteObjectPendingCallWatcher* QAbstractItemModelReplicaImplementation::doMode
 {
     qDeleteAll(m_pendingRequests);
     m_pendingRequests.clear();
+    m_queuedRequests.clear();
+    m_rowRequestsInFlight = 0;
+    m_prefetchFirstRow = m_prefetchLastRow = -1;
     IndexList parentList;
     QRemoteObjectPendingCallWatcher *watcher;
     if (m_initialAction == QtRemoteObjects::FetchRootSize) {
@@ -461,21 +504,24 @@ QRemoteObjectPendingCallWatcher* QAbstractItemModelReplicaImplementation::doMode
     return watcher;
 }
 
-inline void fillCacheEntry(CacheEntry *entry, const IndexValuePair &pair, const QVector<int> &roles)
+inline void fillCacheEntry(CachedRowEntry *row, int column, const IndexValuePair &pair, const QVector<int> &roles, const QAbstractItemModelReplicaImplementation *replica)
 {
-    Q_ASSERT(entry);
+    Q_ASSERT(row);
+    Q_ASSERT(column < row->size());
 
     const QVariantList &data = pair.data;
     Q_ASSERT(roles.size() == data.size());
 
-    entry->flags = pair.flags;
+    row->flags[column] = pair.flags;
 
     qCDebug(QT_REMOTEOBJECT_MODELS) << Q_FUNC_INFO << "data.size=" << data.size();
     for (int i = 0; i < data.size(); ++i) {
         const int role = roles[i];
-        const QVariant dataVal = data[i];
+        const QVariant &dataVal = data[i];
         qCDebug(QT_REMOTEOBJECT_MODELS) << Q_FUNC_INFO << "role=" << role << "data=" << dataVal;
-        entry->data[role] = dataVal;
+        const int slot = replica->roleSlot(role);
+        if (slot >= 0)
+            row->setValue(column, slot, dataVal);
     }
 }
 
@@ -487,19 +533,10 @@ inline void fillRow(CacheData *item, const IndexValuePair &pair, const QAbstract
     qCDebug(QT_REMOTEOBJECT_MODELS) << Q_FUNC_INFO << "row=" << index.row() << "column=" << index.column();
     if (index.column() == 0)
         item->hasChildren = pair.hasChildren;
-    bool existed = false;
-    for (int i = 0; i < rowRef.size(); ++i) {
-        if (i == index.column()) {
-            fillCacheEntry(&rowRef[i], pair, roles);
-            existed = true;
-        }
-    }
-    qCDebug(QT_REMOTEOBJECT_MODELS) << Q_FUNC_INFO << "existed=" << existed;
-    if (!existed) {
-        CacheEntry entries;
-        fillCacheEntry(&entries, pair, roles);
-        rowRef.append(entries);
-    }
+    qCDebug(QT_REMOTEOBJECT_MODELS) << Q_FUNC_INFO << "existed=" << (index.column() < rowRef.size());
+    if (index.column() >= rowRef.size())
+        rowRef.resize(index.column() + 1, item->replicaModel->availableRoles().size());
+    fillCacheEntry(&rowRef, index.column(), pair, roles, item->replicaModel);
 }
 
 int collectEntriesForRow(DataEntries* filteredEntries, int row, const DataEntries &entries, int startIndex)
@@ -528,6 +565,34 @@ void QAbstractItemModelReplicaImplementation::fillCache(const IndexValuePair &pa
         fillCache(it, roles);
 }
 
+void QAbstractItemModelReplicaImplementation::onDataChangedWithValues(const IndexList &start, const IndexList &end, const QVector<int> &roles, const DataEntries &entries)
+{
+    qCDebug(QT_REMOTEOBJECT_MODELS) << Q_FUNC_INFO << "start=" << start << "end=" << end << "roles=" << roles << "entries.size=" << entries.data.size();
+
+    bool ok = true;
+    const QModelIndex startIndex = toQModelIndex(start, q, &ok);
+    if (!ok)
+        return;
+    const QModelIndex endIndex = toQModelIndex(end, q, &ok);
+    if (!ok)
+        return;
+    Q_ASSERT(startIndex.parent() == endIndex.parent());
+    CacheData *parentItem = cacheData(startIndex.parent());
+    if (!parentItem)
+        return;
+
+    // Only cells that are already cached are updated, the others are fetched when they are needed
+    for (const IndexValuePair &pair : entries.data) {
+        const ModelIndex &cell = pair.index.last();
+        if (!parentItem->children.exists(cell.row))
+            continue;
+        CachedRowEntry &rowRef = parentItem->children.get(cell.row)->cachedRowEntry;
+        if (cell.column < rowRef.size())
+            fillCacheEntry(&rowRef, cell.column, pair, roles, this);
+    }
+    emit q->dataChanged(startIndex, endIndex, roles);
+}
+
 void QAbstractItemModelReplicaImplementation::requestedData(QRemoteObjectPendingCallWatcher *qobject)
 {
     RowWatcher *watcher = static_cast<RowWatcher *>(qobject);
@@ -536,6 +601,11 @@ void QAbstractItemModelReplicaImplementation::requestedData(QRemoteObjectPending
 
     qCDebug(QT_REMOTEOBJECT_MODELS) << Q_FUNC_INFO << "start=" << watcher->start << "end=" << watcher->end;
 
+    --m_rowRequestsInFlight;
+    if (watcher->start.size() == 1 && watcher->start.last().row == m_prefetchFirstRow && watcher->end.last().row == m_prefetchLastRow)
+        m_prefetchFirstRow = m_prefetchLastRow = -1;
+    sendQueuedRequests();
+
     IndexList parentList = watcher->start;
     Q_ASSERT(!parentList.isEmpty());
     parentList.pop_back();
@@ -573,9 +643,13 @@ void QAbstractItemModelReplicaImplementation::requestedData(QRemoteObjectPending
 
 void QAbstractItemModelReplicaImplementation::fetchPendingData()
 {
-    if (m_requestedData.isEmpty())
+    m_prefetchScheduled = false;
+    if (m_requestedData.isEmpty() && (!m_prefetchRows || m_viewFirstRow < 0))
         return;
 
+    const int viewFirstRow = qExchange(m_viewFirstRow, -1);
+    const int viewLastRow = qExchange(m_viewLastRow, -1);
+
     qCDebug(QT_REMOTEOBJECT_MODELS) << Q_FUNC_INFO << "m_requestedData.size=" << m_requestedData.size();
 
     std::vector<RequestedData> finalRequests;
@@ -641,17 +715,93 @@ void QAbstractItemModelReplicaImplementation::fetchPendingData()
             }
         }
     }
-    finalRequests.push_back(curData);
+    if (!curData.start.isEmpty())
+        finalRequests.push_back(curData);
     //qCDebug(QT_REMOTEOBJECT_MODELS) << "Final requests" << finalRequests;
+
+    // The newest requests go first, the ones still waiting to be sent are kept if they are
+    // near the rows in view, and the rows ahead of the view go last
+    QVector<RequestedData> queue;
     int rows = 0;
                                                                         // There is no point to eat more than can chew
     for (auto it = finalRequests.rbegin(); it != finalRequests.rend() && size_t(rows) < m_rootItem.children.cacheSize; ++it) {
         qCDebug(QT_REMOTEOBJECT_MODELS) << Q_FUNC_INFO << "FINAL start=" << it->start << "end=" << it->end << "roles=" << it->roles;
-
-        QRemoteObjectPendingReply<DataEntries> reply = replicaRowRequest(it->start, it->end, it->roles);
-        RowWatcher *watcher = new RowWatcher(it->start, it->end, it->roles, reply);
         rows += 1 + it->end.first().row - it->start.first().row;
+        queue.push_back(*it);
+    }
+
+    int ahead = m_prefetchRows;
+    if (viewFirstRow >= 0) {
+        m_viewRowCount = qMax(m_viewRowCount, viewLastRow - viewFirstRow + 1);
+        if (m_lastViewFirstRow >= 0) {
+            const int moved = viewFirstRow - m_lastViewFirstRow;
+            if (moved)
+                m_viewDirection = moved < 0 ? -1 : 1;
+            // Scrolling fast, read as far ahead as the view moved since the last time
+            if (m_prefetchRows > 0)
+                ahead = qMax(ahead, qMin(qAbs(moved), int(m_rootItem.children.cacheSize / 2)));
+        }
+        m_lastViewFirstRow = viewFirstRow;
+    }
+
+    for (const RequestedData &data : qExchange(m_queuedRequests, {})) {
+        const bool stale = viewFirstRow >= 0 && data.start.size() == 1
+                && (data.end.last().row < viewFirstRow - m_viewRowCount - ahead
+                    || data.start.last().row > viewLastRow + m_viewRowCount + ahead);
+        if (stale) {
+            qCDebug(QT_REMOTEOBJECT_MODELS) << Q_FUNC_INFO << "STALE start=" << data.start << "end=" << data.end;
+            if (data.start.last().row == m_prefetchFirstRow && data.end.last().row == m_prefetchLastRow)
+                m_prefetchFirstRow = m_prefetchLastRow = -1;
+            ++m_staleRequests;
+        } else if (size_t(rows) < m_rootItem.children.cacheSize) {
+            rows += 1 + data.end.first().row - data.start.first().row;
+            queue.push_back(data);
+        }
+    }
+
+    if (viewFirstRow >= 0 && m_prefetchRows > 0 && m_rootItem.columnCount > 0) {
+        const int direction = m_viewDirection;
+        int first = direction > 0 ? viewLastRow + 1 : viewFirstRow - ahead;
+        int last = direction > 0 ? viewLastRow + ahead : viewFirstRow - 1;
+        first = qMax(first, 0);
+        last = qMin(last, m_rootItem.rowCount - 1);
+        // Skip the rows next to the view that are cached or requested already
+        if (m_prefetchFirstRow >= 0) {
+            if (direction > 0 && first >= m_prefetchFirstRow && first <= m_prefetchLastRow)
+                first = m_prefetchLastRow + 1;
+            else if (direction < 0 && last >= m_prefetchFirstRow && last <= m_prefetchLastRow)
+                last = m_prefetchFirstRow - 1;
+        }
+        while (first <= last && m_rootItem.children.exists(direction > 0 ? first : last)) {
+            if (direction > 0)
+                ++first;
+            else
+                --last;
+        }
+        if (first <= last) {
+            RequestedData data;
+            data.start << ModelIndex(first, 0);
+            data.end << ModelIndex(last, m_rootItem.columnCount - 1);
+            data.roles = availableRoles();
+            qCDebug(QT_REMOTEOBJECT_MODELS) << Q_FUNC_INFO << "PREFETCH start=" << data.start << "end=" << data.end;
+            queue.push_back(data);
+            m_prefetchFirstRow = first;
+            m_prefetchLastRow = last;
+        }
+    }
+
+    m_queuedRequests = queue;
+    sendQueuedRequests();
+}
+
+void QAbstractItemModelReplicaImplementation::sendQueuedRequests()
+{
+    while (m_rowRequestsInFlight < MaxRowRequestsInFlight && !m_queuedRequests.isEmpty()) {
+        const RequestedData data = m_queuedRequests.takeFirst();
+        QRemoteObjectPendingReply<DataEntries> reply = replicaRowRequest(data.start, data.end, data.roles);
+        RowWatcher *watcher = new RowWatcher(data.start, data.end, data.roles, reply);
         m_pendingRequests.push_back(watcher);
+        ++m_rowRequestsInFlight;
         connect(watcher, &RowWatcher::finished, this, &QAbstractItemModelReplicaImplementation::requestedData);
     }
 }
@@ -670,9 +820,9 @@ void QAbstractItemModelReplicaImplementation::onHeaderDataChanged(Qt::Orientatio
 {
     // TODO clean cache
     const int index = orientation == Qt::Horizontal ? 0 : 1;
-    QVector<CacheEntry> &entries = m_headerData[index];
+    QVector<QHash<int, QVariant>> &entries = m_headerData[index];
     for (int i = first; i < last; ++i )
-        entries[i].data.clear();
+        entries[i].clear();
     emit q->headerDataChanged(orientation, first, last);
 }
 
@@ -736,7 +886,7 @@ void QAbstractItemModelReplicaImplementation::requestedHeaderData(QRemoteObjectP
             verticalSections.append(watcher->sections[i]);
         const int index = watcher->orientations[i] == Qt::Horizontal ? 0 : 1;
         const int role = watcher->roles[i];
-        QHash<int, QVariant> &dat = m_headerData[index][watcher->sections[i]].data;
+        QHash<int, QVariant> &dat = m_headerData[index][watcher->sections[i]];
         dat[role] = data[i];
     }
     QVector<QPair<int, int> > horRanges = listRanges(horizontalSections);
@@ -765,15 +915,13 @@ QAbstractItemModelReplica::~QAbstractItemModelReplica()
 {
 }
 
-static QVariant findData(const CachedRowEntry &row, const QModelIndex &index, int role, bool *cached = 0)
+static QVariant findData(const CachedRowEntry &row, const QModelIndex &index, int slot, bool *cached = 0)
 {
     if (index.column() < row.size()) {
-        const CacheEntry &entry = row[index.column()];
-        QHash<int, QVariant>::ConstIterator it = entry.data.constFind(role);
-        if (it != entry.data.constEnd()) {
+        if (const QVariant *value = row.value(index.column(), slot)) {
             if (cached)
                 *cached = true;
-            return it.value();
+            return *value;
         }
     }
     if (cached)
@@ -827,16 +975,25 @@ QVariant QAbstractItemModelReplica::data(const QModelIndex & index, int role) co
     if (!index.isValid())
         return QVariant();
 
-    if (!availableRoles().contains(role))
+    const int slot = d->roleSlot(role);
+    if (slot < 0)
         return QVariant();
 
+    if (index.internalPointer() == &d->m_rootItem) {
+        d->trackViewRow(index.row());
+        d->checkPrefetch(index.row());
+    }
+
     auto item = d->cacheData(index);
     if (item) {
         bool cached = false;
-        QVariant result = findData(item->cachedRowEntry, index, role, &cached);
-        if (cached)
+        QVariant result = findData(item->cachedRowEntry, index, slot, &cached);
+        if (cached) {
+            ++d->m_cacheHits;
             return result;
+        }
     }
+    ++d->m_cacheMisses;
 
     auto parentItem = d->cacheData(index.parent());
     Q_ASSERT(parentItem);
@@ -931,11 +1088,11 @@ int QAbstractItemModelReplica::columnCount(const QModelIndex &parent) const
 QVariant QAbstractItemModelReplica::headerData(int section, Qt::Orientation orientation, int role) const
 {
     const int index = orientation == Qt::Horizontal ? 0 : 1;
-    const QVector<CacheEntry> elem = d->m_headerData[index];
+    const QVector<QHash<int, QVariant>> &elem = d->m_headerData[index];
     if (section >= elem.size())
         return QVariant();
 
-    const QHash<int, QVariant> &dat = elem.at(section).data;
+    const QHash<int, QVariant> &dat = elem.at(section);
     QHash<int, QVariant>::ConstIterator it = dat.constFind(role);
     if (it != dat.constEnd())
         return it.value();
@@ -951,8 +1108,7 @@ QVariant QAbstractItemModelReplica::headerData(int section, Qt::Orientation orie
 
 Qt::ItemFlags QAbstractItemModelReplica::flags(const QModelIndex &index) const
 {
-    CacheEntry *entry = d->cacheEntry(index);
-    return entry ? entry->flags : Qt::NoItemFlags;
+    return d->cachedFlags(index);
 }
 
 bool QAbstractItemModelReplica::isInitialized() const
@@ -969,7 +1125,10 @@ bool QAbstractItemModelReplica::hasData(const QModelIndex &index, int role) cons
         return false;
     bool cached = false;
     const CachedRowEntry &entry = item->cachedRowEntry;
-    QVariant result = findData(entry, index, role, &cached);
+    const int slot = d->roleSlot(role);
+    if (slot < 0)
+        return false;
+    QVariant result = findData(entry, index, slot, &cached);
     Q_UNUSED(result);
     return cached;
 }
@@ -984,6 +1143,31 @@ void QAbstractItemModelReplica::setRootCacheSize(size_t rootCacheSize)
     d->m_rootItem.children.setCacheSize(rootCacheSize);
 }
 
+int QAbstractItemModelReplica::prefetchRows() const
+{
+    return d->m_prefetchRows;
+}
+
+void QAbstractItemModelReplica::setPrefetchRows(int rows)
+{
+    d->m_prefetchRows = qMax(rows, 0);
+}
+
+quint64 QAbstractItemModelReplica::cacheHitCount() const
+{
+    return d->m_cacheHits;
+}
+
+quint64 QAbstractItemModelReplica::cacheMissCount() const
+{
+    return d->m_cacheMisses;
+}
+
+quint64 QAbstractItemModelReplica::staleRequestCount() const
+{
+    return d->m_staleRequests;
+}
+
 QVector<int> QAbstractItemModelReplica::availableRoles() const
 {
     return d->availableRoles();
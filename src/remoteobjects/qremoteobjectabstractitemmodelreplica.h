@@ -75,6 +75,12 @@ public:
     size_t rootCacheSize() const;
     void setRootCacheSize(size_t rootCacheSize);
 
+    int prefetchRows() const;
+    void setPrefetchRows(int rows);
+    quint64 cacheHitCount() const;
+    quint64 cacheMissCount() const;
+    quint64 staleRequestCount() const;
+
 Q_SIGNALS:
     void initialized();
 
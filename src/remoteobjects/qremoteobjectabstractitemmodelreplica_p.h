@@ -55,35 +55,99 @@
 #include "qremoteobjectabstractitemmodelreplica.h"
 #include "qremoteobjectreplica.h"
 #include "qremoteobjectpendingcall.h"
+#include <QtCore/qbitarray.h>
 #include <list>
+#include <utility>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 QT_BEGIN_NAMESPACE
 
 namespace {
     const int DefaultNodesCacheSize = 1000;
+    const int MaxRowRequestsInFlight = 4;
 }
 
-struct CacheEntry
+// The cached cells of a row. The values of all cells are stored in one array,
+// with a slot per role of the replica, see
+// QAbstractItemModelReplicaImplementation::roleSlot().
+struct CachedRowEntry
 {
-    QHash<int, QVariant> data;
-    Qt::ItemFlags flags;
+    QVector<Qt::ItemFlags> flags;
+    QVector<QVariant> values;
+    QBitArray cached;
+    int roleCount = 0;
 
-    explicit CacheEntry()
-        : flags(Qt::NoItemFlags)
-    {}
-};
+    int size() const { return flags.size(); }
+
+    void resize(int columns, int roles)
+    {
+        Q_ASSERT(flags.isEmpty() || roles == roleCount);
+        roleCount = roles;
+        flags.resize(columns);
+        values.resize(columns * roles);
+        cached.resize(columns * roles);
+    }
+
+    const QVariant *value(int column, int slot) const
+    {
+        const int i = column * roleCount + slot;
+        return cached.testBit(i) ? &values.at(i) : nullptr;
+    }
+
+    void setValue(int column, int slot, const QVariant &value)
+    {
+        const int i = column * roleCount + slot;
+        values[i] = value;
+        cached.setBit(i);
+    }
+
+    void clearValue(int column, int slot)
+    {
+        const int i = column * roleCount + slot;
+        values[i] = QVariant();
+        cached.clearBit(i);
+    }
+
+    void clearValues(int column)
+    {
+        for (int slot = 0; slot < roleCount; ++slot)
+            clearValue(column, slot);
+    }
 
-typedef QVector<CacheEntry> CachedRowEntry;
+    void clear()
+    {
+        flags.clear();
+        values.clear();
+        cached.clear();
+    }
+};
 
+// Cached values ordered by key, for the rows of a CacheData. Only a few rows of
+// a large model are cached, so the nodes are kept in a treap where each node
+// stores the distance of its key to the key of the previous node. Inserting or
+// removing a range of keys then only changes the node following the range,
+// which is O(log n) instead of touching every cached node.
 template <class Key, class Value>
 struct LRUCache
 {
-    typedef std::pair<Key, Value*> Pair;
-    std::list<Pair> cachedItems;
-    typedef typename std::list<Pair>::iterator CacheIterator;
-    std::unordered_map<Key, CacheIterator> cachedItemsMap;
+    struct Node
+    {
+        Node *left = nullptr;
+        Node *right = nullptr;
+        Node *parent = nullptr;
+        Key delta = 0; // key - key of the previous node
+        Key span = 0; // sum of delta in this subtree
+        quint32 priority = 0;
+        Value *value = nullptr;
+        typename std::list<Node>::iterator item;
+    };
+    std::list<Node> cachedItems; // most recently used first
+    typedef typename std::list<Node>::iterator CacheIterator;
+    std::unordered_map<const Value *, Node *> cachedValues;
+    Node *root = nullptr;
+    quint32 seed = 0x9e3779b9;
     size_t cacheSize;
 
     explicit LRUCache()
@@ -101,121 +165,302 @@ struct LRUCache
 
     inline void cleanCache()
     {
-        Q_ASSERT(cachedItems.size() == cachedItemsMap.size());
+        Q_ASSERT(cachedItems.size() == cachedValues.size());
 
-        auto it = cachedItems.rbegin();
-        while (cachedItemsMap.size() > cacheSize) {
+        auto it = cachedItems.end();
+        while (cachedItems.size() > cacheSize && it != cachedItems.begin()) {
+            --it;
             // Do not trash elements with children
             // Workaround QTreeView bugs which caches the children indexes for very long time
-            while (it->second->hasChildren && it != cachedItems.rend())
-                ++it;
+            if (it->value->hasChildren)
+                continue;
 
-            if (it == cachedItems.rend())
-                break;
-
-            cachedItemsMap.erase(it->first);
-            delete it->second;
-            cachedItems.erase((++it).base());
+            unlink(&*it);
+            cachedValues.erase(it->value);
+            delete it->value;
+            it = cachedItems.erase(it);
         }
-        Q_ASSERT(cachedItems.size() == cachedItemsMap.size());
+        Q_ASSERT(cachedItems.size() == cachedValues.size());
     }
 
     void setCacheSize(size_t rootCacheSize)
     {
         cacheSize = rootCacheSize;
         cleanCache();
-        cachedItemsMap.reserve(rootCacheSize);
+        cachedValues.reserve(rootCacheSize);
     }
 
-    void changeKeys(Key key, Key delta) {
-        std::vector<std::pair<Key, CacheIterator>> changed;
-        auto it = cachedItemsMap.begin();
-        while (it != cachedItemsMap.end()) {
-            if (it->first >= key) {
-                changed.emplace_back(it->first + delta, it->second);
-                it->second->first += delta;
-                it = cachedItemsMap.erase(it);
-            } else {
-                ++it;
-            }
+    // Moves the keys from key on by count, for rows inserted at key
+    void insert(Key key, Key count)
+    {
+        Key pos;
+        if (Node *node = lowerBound(key, &pos)) {
+            node->delta += count;
+            updateSpans(node);
         }
-        for (auto pair : changed)
-            cachedItemsMap[pair.first] = pair.second;
     }
 
-    void insert(Key key, Value *value)
+    void ensure(Key key, Value *value)
     {
-        changeKeys(key, 1);
-        ensure(key, value);
-        Q_ASSERT(cachedItems.size() == cachedItemsMap.size());
+        Q_ASSERT(!exists(key));
+        cachedItems.emplace_front();
+        Node *node = &cachedItems.front();
+        node->value = value;
+        node->item = cachedItems.begin();
+        cachedValues[value] = node;
+        link(node, key);
+        cleanCache();
     }
 
-    void ensure(Key key, Value *value)
+    // Drops the values of keys from key to key + count - 1 and moves the following keys back
+    void remove(Key key, Key count)
     {
-        cachedItems.emplace_front(key, value);
-        cachedItemsMap[key] = cachedItems.begin();
-        cleanCache();
+        Key pos;
+        Node *node = lowerBound(key, &pos);
+        while (node && pos < key + count) {
+            Node *next = successor(node);
+            if (next)
+                pos += next->delta;
+            unlink(node);
+            cachedValues.erase(node->value);
+            delete node->value;
+            cachedItems.erase(node->item);
+            node = next;
+        }
+        if (node) {
+            node->delta -= count;
+            updateSpans(node);
+        }
+        Q_ASSERT(cachedItems.size() == cachedValues.size());
     }
 
-    void remove(Key key)
+    // Moves the keys from key to key + count - 1 in front of to, which must not be within
+    // them, like QAbstractItemModel::moveRows() moves rows. Only the moved nodes are relinked.
+    void move(Key key, Key count, Key to)
     {
-        auto it = cachedItemsMap.find(key);
-        if (it != cachedItemsMap.end()) {
-            delete it->second->second;
-            cachedItems.erase(it->second);
-            cachedItemsMap.erase(it);
+        std::vector<std::pair<Node *, Key>> moved; // with their offset from key
+        Key pos;
+        Node *node = lowerBound(key, &pos);
+        while (node && pos < key + count) {
+            Node *next = successor(node);
+            const Key nextPos = next ? pos + next->delta : pos;
+            unlink(node);
+            moved.emplace_back(node, pos - key);
+            node = next;
+            pos = nextPos;
+        }
+        if (node) {
+            node->delta -= count;
+            updateSpans(node);
+        }
+        const Key start = to > key ? to - count : to;
+        insert(start, count);
+        for (const auto &entry : moved) {
+            entry.first->left = entry.first->right = entry.first->parent = nullptr;
+            link(entry.first, start + entry.second);
         }
-        changeKeys(key, -1);
-        Q_ASSERT(cachedItems.size() == cachedItemsMap.size());
     }
 
     Value *get(Key key)
     {
-        auto it = cachedItemsMap.find(key);
-        if (it == cachedItemsMap.end())
+        Node *node = findNode(key);
+        if (!node)
             return nullptr;
 
         // Move the accessed item to front
-        cachedItems.splice(cachedItems.begin(), cachedItems, it->second);
-        Q_ASSERT(it->second->first == key);
-        return it->second->second;
+        cachedItems.splice(cachedItems.begin(), cachedItems, node->item);
+        return node->value;
     }
 
     Key find(Value *val)
     {
-        for (auto it = cachedItemsMap.begin(); it != cachedItemsMap.end(); ++it) {
-            if (it->second->second == val)
-                return it->first;
-        }
+        auto it = cachedValues.find(val);
+        if (it != cachedValues.end())
+            return position(it->second);
         Q_ASSERT_X(false, __FUNCTION__, "Value not found");
         return Key{};
     }
 
     bool exists(Value *val)
     {
-        for (const auto &pair : cachedItems)
-            if (pair.second == val)
-                return true;
-
-        return false;
+        return cachedValues.find(val) != cachedValues.end();
     }
 
     bool exists(Key key)
     {
-        return cachedItemsMap.find(key) != cachedItemsMap.end();
+        return findNode(key) != nullptr;
     }
 
     size_t size()
     {
-        return cachedItemsMap.size();
+        return cachedItems.size();
     }
 
     void clear()
     {
-        for (const auto &pair : cachedItems)
-            delete pair.second;
+        for (const auto &node : cachedItems)
+            delete node.value;
         cachedItems.clear();
-        cachedItemsMap.clear();
+        cachedValues.clear();
+        root = nullptr;
+    }
+
+private:
+    static Key span(const Node *node) { return node ? node->span : 0; }
+
+    static void updateSpan(Node *node)
+    {
+        node->span = span(node->left) + node->delta + span(node->right);
+    }
+
+    static void updateSpans(Node *node)
+    {
+        for (; node; node = node->parent)
+            updateSpan(node);
+    }
+
+    static Node *successor(Node *node)
+    {
+        if (node->right) {
+            node = node->right;
+            while (node->left)
+                node = node->left;
+            return node;
+        }
+        while (node->parent && node->parent->right == node)
+            node = node->parent;
+        return node->parent;
+    }
+
+    static Key position(const Node *node)
+    {
+        Key pos = span(node->left) + node->delta;
+        for (; node->parent; node = node->parent) {
+            if (node->parent->right == node)
+                pos += span(node->parent->left) + node->parent->delta;
+        }
+        return pos;
+    }
+
+    Node *findNode(Key key) const
+    {
+        Node *node = root;
+        Key base = 0;
+        while (node) {
+            const Key pos = base + span(node->left) + node->delta;
+            if (key == pos)
+                return node;
+            if (key < pos) {
+                node = node->left;
+            } else {
+                base = pos;
+                node = node->right;
+            }
+        }
+        return nullptr;
+    }
+
+    // The first node with a key not less than key, its key is stored in pos
+    Node *lowerBound(Key key, Key *pos) const
+    {
+        Node *node = root;
+        Node *result = nullptr;
+        Key base = 0;
+        while (node) {
+            const Key nodePos = base + span(node->left) + node->delta;
+            if (nodePos >= key) {
+                result = node;
+                *pos = nodePos;
+                node = node->left;
+            } else {
+                base = nodePos;
+                node = node->right;
+            }
+        }
+        return result;
+    }
+
+    void rotateUp(Node *node)
+    {
+        Node *parent = node->parent;
+        Node *grandParent = parent->parent;
+        if (parent->left == node) {
+            parent->left = node->right;
+            if (node->right)
+                node->right->parent = parent;
+            node->right = parent;
+        } else {
+            parent->right = node->left;
+            if (node->left)
+                node->left->parent = parent;
+            node->left = parent;
+        }
+        parent->parent = node;
+        node->parent = grandParent;
+        if (!grandParent)
+            root = node;
+        else if (grandParent->left == parent)
+            grandParent->left = node;
+        else
+            grandParent->right = node;
+        updateSpan(parent);
+        updateSpan(node);
+    }
+
+    void link(Node *node, Key key)
+    {
+        // xorshift, the priorities only need to be spread evenly
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        node->priority = seed;
+
+        Node *parent = nullptr;
+        Node *next = nullptr;
+        Node **link = &root;
+        Key base = 0;
+        while (*link) {
+            parent = *link;
+            const Key pos = base + span(parent->left) + parent->delta;
+            if (key < pos) {
+                next = parent;
+                link = &parent->left;
+            } else {
+                base = pos;
+                link = &parent->right;
+            }
+        }
+        node->parent = parent;
+        node->delta = key - base;
+        node->span = node->delta;
+        *link = node;
+        if (next)
+            next->delta -= node->delta;
+        updateSpans(parent);
+        while (node->parent && node->parent->priority < node->priority)
+            rotateUp(node);
+    }
+
+    void unlink(Node *node)
+    {
+        Node *next = successor(node);
+        while (node->left && node->right)
+            rotateUp(node->left->priority > node->right->priority ? node->left : node->right);
+        Node *child = node->left ? node->left : node->right;
+        Node *parent = node->parent;
+        if (child)
+            child->parent = parent;
+        if (!parent)
+            root = child;
+        else if (parent->left == node)
+            parent->left = child;
+        else
+            parent->right = child;
+        updateSpans(parent);
+        if (next) {
+            next->delta += node->delta;
+            updateSpans(next);
+        }
     }
 };
 
@@ -237,30 +482,41 @@ struct CacheData
 
     void ensureChildren(int start, int end)
     {
-        for (int i = start; i <= end; ++i)
-            if (!children.exists(i))
-                children.ensure(i, new CacheData(replicaModel, this));
+        for (int i = start; i <= end; ++i) {
+            if (!children.exists(i)) {
+                // Until its own size is known, a row has as many columns as its siblings
+                CacheData *child = new CacheData(replicaModel, this);
+                child->columnCount = columnCount;
+                children.ensure(i, child);
+            }
+        }
     }
 
+    // The inserted rows are created by ensureChildren() when they are needed
     void insertChildren(int start, int end) {
         Q_ASSERT_X(start >= 0 && start <= end, __FUNCTION__, qPrintable(QString(QLatin1String("0 <= %1 <= %2")).arg(start).arg(end)));
-        for (int i = start; i <= end; ++i) {
-            auto cacheData = new CacheData(replicaModel, this);
-            cacheData->columnCount = columnCount;
-            children.insert(i, cacheData);
-            ++rowCount;
-        }
+        children.insert(start, end - start + 1);
+        rowCount += end - start + 1;
         if (rowCount)
             hasChildren = true;
     }
+    // The rows keep their cached values and children
+    void moveChildren(int start, int end, int destination) {
+        Q_ASSERT_X(start >= 0 && start <= end && end < rowCount && (destination < start || destination > end + 1) && destination <= rowCount,
+                   __FUNCTION__, qPrintable(QString(QLatin1String("0 <= %1 <= %2 < %3, %4")).arg(start).arg(end).arg(rowCount).arg(destination)));
+        children.move(start, end - start + 1, destination);
+    }
     void removeChildren(int start, int end) {
         Q_ASSERT_X(start >= 0 && start <= end && end < rowCount, __FUNCTION__, qPrintable(QString(QLatin1String("0 <= %1 <= %2 < %3")).arg(start).arg(end).arg(rowCount)));
-        for (int i = end; i >= start; --i) {
-            children.remove(i);
-            --rowCount;
-        }
+        children.remove(start, end - start + 1);
+        rowCount -= end - start + 1;
         hasChildren = rowCount;
     }
+    void clearValues() {
+        cachedRowEntry.clear();
+        for (const auto &node : children.cachedItems)
+            node.value->clearValues();
+    }
     void clear() {
         cachedRowEntry.clear();
         children.clear();
@@ -336,11 +592,23 @@ public:
 
     inline const QVector<int> &availableRoles() const
     {
-        if (m_availableRoles.isEmpty())
+        if (m_availableRoles.isEmpty()) {
             m_availableRoles = propAsVariant(0).value<QVector<int> >();
+            updateRoleSlots();
+        }
         return m_availableRoles;
     }
 
+    // Cached values are stored at the index of their role in availableRoles()
+    inline int roleSlot(int role) const
+    {
+        const QVector<int> &roles = availableRoles();
+        if (uint(role) < uint(m_roleSlots.size()))
+            return m_roleSlots.at(role);
+        return m_roleSlots.isEmpty() ? roles.indexOf(role) : -1;
+    }
+    void updateRoleSlots() const;
+
     QHash<int, QByteArray> roleNames() const
     {
        QIntHash roles = propAsVariant(1).value<QIntHash>();
@@ -360,6 +628,7 @@ Q_SIGNALS:
     void modelReset();
     void headerDataChanged(Qt::Orientation,int,int);
     void columnsInserted(IndexList parent, int first, int last);
+    void dataChangedWithValues(IndexList topLeft, IndexList bottomRight, QVector<int> roles, DataEntries entries);
 
 public Q_SLOTS:
     QRemoteObjectPendingReply<QSize> replicaSizeRequest(IndexList parentList)
@@ -406,16 +675,18 @@ public Q_SLOTS:
     }
     void onHeaderDataChanged(Qt::Orientation orientation, int first, int last);
     void onDataChanged(const IndexList &start, const IndexList &end, const QVector<int> &roles);
+    void onDataChangedWithValues(const IndexList &start, const IndexList &end, const QVector<int> &roles, const DataEntries &entries);
     void onRowsInserted(const IndexList &parent, int start, int end);
     void onRowsRemoved(const IndexList &parent, int start, int end);
     void onColumnsInserted(const IndexList &parent, int start, int end);
-    void onRowsMoved(IndexList srcParent, int srcRow, int count, IndexList destParent, int destRow);
+    void onRowsMoved(IndexList srcParent, int srcRow, int srcEnd, IndexList destParent, int destRow);
     void onCurrentChanged(IndexList current, IndexList previous);
     void onModelReset();
     void requestedData(QRemoteObjectPendingCallWatcher *);
     void requestedHeaderData(QRemoteObjectPendingCallWatcher *);
     void init();
     void fetchPendingData();
+    void sendQueuedRequests();
     void fetchPendingHeaderData();
     void handleInitDone(QRemoteObjectPendingCallWatcher *watcher);
     void handleModelResetDone(QRemoteObjectPendingCallWatcher *watcher);
@@ -425,7 +696,7 @@ public Q_SLOTS:
 
 public:
     QScopedPointer<QItemSelectionModel> m_selectionModel;
-    QVector<CacheEntry> m_headerData[2];
+    QVector<QHash<int, QVariant>> m_headerData[2];
 
     CacheData m_rootItem;
     inline CacheData* cacheData(const QModelIndex &index) const {
@@ -438,6 +709,25 @@ public:
         }
         return nullptr;
     }
+    // The root rows read by data() since the last fetchPendingData(), roughly the rows in view
+    inline void trackViewRow(int row) {
+        if (m_viewFirstRow < 0 || row < m_viewFirstRow)
+            m_viewFirstRow = row;
+        if (row > m_viewLastRow)
+            m_viewLastRow = row;
+    }
+    // Reads further ahead once the view got halfway through the rows read ahead
+    inline void checkPrefetch(int row) {
+        if (m_prefetchRows <= 0 || m_prefetchScheduled)
+            return;
+        const int edge = row + m_viewDirection * (m_prefetchRows / 2 + 1);
+        if (edge < 0 || edge >= m_rootItem.rowCount || m_rootItem.children.exists(edge))
+            return;
+        if (edge >= m_prefetchFirstRow && edge <= m_prefetchLastRow)
+            return;
+        m_prefetchScheduled = true;
+        QMetaObject::invokeMethod(this, "fetchPendingData", Qt::QueuedConnection);
+    }
     inline CacheData* cacheData(const IndexList &index) const {
         return cacheData(toQModelIndex(index, q));
     }
@@ -446,15 +736,11 @@ public:
         cacheData(modelIndex.parent())->ensureChildren(modelIndex.row() , modelIndex.row());
         return cacheData(modelIndex);
     }
-    inline CacheEntry* cacheEntry(const QModelIndex &index) const {
+    inline Qt::ItemFlags cachedFlags(const QModelIndex &index) const {
         auto data = cacheData(index);
         if (!data || index.column() < 0 || index.column() >= data->cachedRowEntry.size())
-            return nullptr;
-        CacheEntry &entry = data->cachedRowEntry[index.column()];
-        return &entry;
-    }
-    inline CacheEntry* cacheEntry(const IndexList &index) const {
-        return cacheEntry(toQModelIndex(index, q));
+            return Qt::NoItemFlags;
+        return data->cachedRowEntry.flags.at(index.column());
     }
 
     QRemoteObjectPendingCallWatcher *doModelReset();
@@ -464,8 +750,23 @@ public:
     QVector<RequestedData> m_requestedData;
     QVector<RequestedHeaderData> m_requestedHeaderData;
     QVector<QRemoteObjectPendingCallWatcher*> m_pendingRequests;
+    QVector<RequestedData> m_queuedRequests;
+    int m_rowRequestsInFlight = 0;
+    int m_prefetchRows = 0;
+    int m_viewFirstRow = -1;
+    int m_viewLastRow = -1;
+    int m_viewRowCount = 0;
+    int m_lastViewFirstRow = -1;
+    int m_viewDirection = 1;
+    int m_prefetchFirstRow = -1;
+    int m_prefetchLastRow = -1;
+    bool m_prefetchScheduled = false;
+    quint64 m_cacheHits = 0;
+    quint64 m_cacheMisses = 0;
+    quint64 m_staleRequests = 0;
     QAbstractItemModelReplica *q;
     mutable QVector<int> m_availableRoles;
+    mutable QVector<int> m_roleSlots;
     std::unordered_set<CacheData*> m_activeParents;
     QtRemoteObjects::InitialAction m_initialAction;
     QVector<int> m_initialFetchRolesHint;
@@ -51,8 +51,10 @@
 #include "qremoteobjectabstractitemmodelreplica_p.h"
 #include "qremoteobjectabstractitemmodeladapter_p.h"
 #include <QtCore/qabstractitemmodel.h>
+#include <QtCore/qrandom.h>
 #include <memory>
 #include <algorithm>
+#include <limits>
 
 QT_BEGIN_NAMESPACE
 
@@ -246,22 +248,31 @@ QRemoteObjectSourceLocations QRemoteObjectRegistryHostPrivate::remoteObjectAddre
 /*!
     \reimp
 */
-void QRemoteObjectNode::timerEvent(QTimerEvent*)
+void QRemoteObjectNode::timerEvent(QTimerEvent *event)
 {
     Q_D(QRemoteObjectNode);
 
+    if (event->timerId() == d->heartbeatTimer.timerId()) {
+        d->checkHeartbeats();
+        return;
+    }
+
     for (auto it = d->pendingReconnect.begin(), end = d->pendingReconnect.end(); it != end; /*erasing*/) {
-        const auto &conn = *it;
+        ClientIoDevice *conn = it.key();
         if (conn->isOpen()) {
+            // Connecting, the device asks again if that fails
             it = d->pendingReconnect.erase(it);
-        } else {
+        } else if (it.value().hasExpired()) {
             conn->connectToServer();
+            // In case the attempt fails without the device asking to reconnect
+            it.value() = QDeadlineTimer(d->reconnectDelay(d->reconnectStates[conn->url()].attempts++));
+            ++it;
+        } else {
             ++it;
         }
     }
 
-    if (d->pendingReconnect.isEmpty())
-        d->reconnectTimer.stop();
+    d->scheduleReconnect();
 
     qRODebug(this) << "timerEvent" << d->pendingReconnect.size();
 }
@@ -277,6 +288,11 @@ void QRemoteObjectNode::timerEvent(QTimerEvent*)
     connection. This function can help with that detection since the client will
     only detect that the server is unavailable when it tries to send data.
 
+    The message is sent once per connection, shared by all replicas using it,
+    and only when nothing was received on the connection during the interval.
+    The connection is considered lost if nothing arrives during the interval
+    following the message.
+
     A value of \c 0 (the default) will disable the heartbeat.
 */
 
@@ -291,6 +307,11 @@ void QRemoteObjectNode::timerEvent(QTimerEvent*)
     connection. This function can help with that detection since the client will
     only detect that the server is unavailable when it tries to send data.
 
+    The message is sent once per connection, shared by all replicas using it,
+    and only when nothing was received on the connection during the interval.
+    The connection is considered lost if nothing arrives during the interval
+    following the message.
+
     A value of \c 0 (the default) will disable the heartbeat.
 */
 int QRemoteObjectNode::heartbeatInterval() const
@@ -305,9 +326,174 @@ void QRemoteObjectNode::setHeartbeatInterval(int interval)
     if (d->m_heartbeatInterval == interval)
         return;
     d->m_heartbeatInterval = interval;
+    if (interval > 0)
+        d->heartbeatTimer.start(interval, Qt::CoarseTimer, this);
+    else
+        d->heartbeatTimer.stop();
     emit heartbeatIntervalChanged(interval);
 }
 
+/*!
+    \qmlproperty int Node::compressionThreshold
+
+    Minimum size in bytes of the data sent at once that is compressed.
+
+    Large payloads, like model data or the type definitions sent to dynamic
+    replicas, are compressed with qCompress() before they are sent, if both
+    ends of the connection enable compression. Compression is negotiated when
+    a connection is established, so changes only affect new connections.
+
+    A value of \c 0 (the default) will disable compression.
+*/
+
+/*!
+    \property QRemoteObjectNode::compressionThreshold
+    \brief Minimum size in bytes of the data sent at once that is compressed.
+    \since 6.0
+
+    Large payloads, like model data or the type definitions sent to dynamic
+    replicas, are compressed with qCompress() before they are sent, if both
+    ends of the connection enable compression. Each end uses its own
+    threshold. Data that does not get smaller is sent uncompressed.
+    Compression is negotiated when a connection is established, so changes
+    only affect new connections.
+
+    A value of \c 0 (the default) will disable compression.
+*/
+int QRemoteObjectNode::compressionThreshold() const
+{
+    Q_D(const QRemoteObjectNode);
+    return d->m_compressionThreshold;
+}
+
+void QRemoteObjectNode::setCompressionThreshold(int bytes)
+{
+    Q_D(QRemoteObjectNode);
+    bytes = qMax(bytes, 0);
+    if (d->m_compressionThreshold == bytes)
+        return;
+    d->m_compressionThreshold = bytes;
+    if (qobject_cast<QRemoteObjectHostBase *>(this)) {
+        auto hostd = static_cast<QRemoteObjectHostBasePrivate *>(d);
+        if (hostd->remoteObjectIo)
+            hostd->remoteObjectIo->m_compressionThreshold = bytes;
+    }
+    emit compressionThresholdChanged(bytes);
+}
+
+/*!
+    \since 6.0
+
+    Returns the time in milliseconds a replica of this node waits for the reply
+    to a call, before the call finishes with the
+    QRemoteObjectPendingCall::Timeout error. A late reply is dropped.
+
+    A value of \c 0 (the default) lets calls wait for their reply as long as the
+    replica exists. A replica keeps at most maxPendingCalls() calls waiting
+    though: when a call is made while that many are waiting, the oldest of
+    them finishes with the QRemoteObjectPendingCall::Timeout error, so replies
+    that got lost can't exhaust memory.
+
+    \sa setCallTimeout(), QRemoteObjectReplica::expiredCallCount()
+*/
+int QRemoteObjectNode::callTimeout() const
+{
+    Q_D(const QRemoteObjectNode);
+    return d->m_callTimeout;
+}
+
+/*!
+    \since 6.0
+
+    Sets the time in milliseconds replicas of this node wait for the reply to a
+    call to \a msecs. It applies to calls made after this.
+
+    \sa callTimeout()
+*/
+void QRemoteObjectNode::setCallTimeout(int msecs)
+{
+    Q_D(QRemoteObjectNode);
+    d->m_callTimeout = qMax(msecs, 0);
+}
+
+/*!
+    \since 6.0
+
+    Returns the number of calls a replica of this node keeps waiting for a
+    reply. The default is 1024. When a call is made while that many are
+    waiting, the oldest of them finishes with the
+    QRemoteObjectPendingCall::Timeout error.
+
+    \sa setMaxPendingCalls(), callTimeout()
+*/
+int QRemoteObjectNode::maxPendingCalls() const
+{
+    Q_D(const QRemoteObjectNode);
+    return d->m_maxPendingCalls;
+}
+
+/*!
+    \since 6.0
+
+    Sets the number of calls a replica of this node keeps waiting for a reply
+    to \a count, rounded up to a power of two, up to 1048576. The memory for
+    them is reserved once the replica makes its first call that expects a
+    reply. It applies to replicas acquired after this.
+
+    \sa maxPendingCalls()
+*/
+void QRemoteObjectNode::setMaxPendingCalls(int count)
+{
+    Q_D(QRemoteObjectNode);
+    d->m_maxPendingCalls = qBound(1, count, int(PendingCallSlab::maxCapacity));
+}
+
+/*!
+    \since 6.0
+
+    Returns how many times a connection to a node requested with
+    connectToNode() was lost and established again.
+
+    Lost connections are retried with an exponential backoff, starting at
+    250 milliseconds and doubling up to 30 seconds between attempts. Each delay
+    is randomized by up to half its length, so that nodes which lost the same
+    host don't all reconnect at the same time.
+
+    \sa lastReconnectLatency(), maxReconnectLatency()
+*/
+quint64 QRemoteObjectNode::reconnectCount() const
+{
+    Q_D(const QRemoteObjectNode);
+    return d->reconnectCount;
+}
+
+/*!
+    \since 6.0
+
+    Returns the time in milliseconds between losing the connection to a node
+    and the node greeting us again, for the latest reconnect.
+
+    \sa reconnectCount(), maxReconnectLatency()
+*/
+qint64 QRemoteObjectNode::lastReconnectLatency() const
+{
+    Q_D(const QRemoteObjectNode);
+    return d->lastReconnectLatency;
+}
+
+/*!
+    \since 6.0
+
+    Returns the longest time in milliseconds a reconnect took so far.
+
+    \sa reconnectCount(), lastReconnectLatency()
+*/
+qint64 QRemoteObjectNode::maxReconnectLatency() const
+{
+    Q_D(const QRemoteObjectNode);
+    return d->maxReconnectLatency;
+}
+
 /*!
     \since 5.12
     \typedef QRemoteObjectNode::RemoteObjectSchemaHandler
@@ -1123,6 +1309,9 @@ bool QRemoteObjectNodePrivate::initConnection(const QUrl &address)
     QObject::connect(connection, &IoDeviceBase::readyRead, q, [this, connection]() {
         onClientRead(connection);
     });
+    QObject::connect(connection, &QObject::destroyed, q, [this, connection]() {
+        replicasById.remove(connection);
+    });
     connection->connectToServer();
 
     return true;
@@ -1194,10 +1383,61 @@ void QRemoteObjectNodePrivate::onRegistryInitialized()
     }
 }
 
-void QRemoteObjectNodePrivate::onShouldReconnect(ClientIoDevice *ioDevice)
+// Exponential backoff with jitter, so nodes that lost the same host don't retry in lock-step
+int QRemoteObjectNodePrivate::reconnectDelay(int attempts) const
+{
+    const int delay = int(qMin(qint64(retryInterval) << qMin(attempts, 16), qint64(maxRetryInterval)));
+    return delay / 2 + int(QRandomGenerator::global()->bounded(delay / 2 + 1));
+}
+
+// Wakes up for the earliest pending reconnect
+void QRemoteObjectNodePrivate::scheduleReconnect()
 {
     Q_Q(QRemoteObjectNode);
 
+    if (pendingReconnect.isEmpty()) {
+        reconnectTimer.stop();
+        return;
+    }
+    qint64 next = std::numeric_limits<qint64>::max();
+    for (const QDeadlineTimer &deadline : qAsConst(pendingReconnect))
+        next = qMin(next, deadline.remainingTime());
+    reconnectTimer.start(int(qMax(next, qint64(0))), q);
+}
+
+// Sends a Ping on each connection to a source that was silent for an interval.
+// A connection that also stays silent for the interval after its Ping is
+// considered lost, which makes its replicas Suspect.
+void QRemoteObjectNodePrivate::checkHeartbeats()
+{
+    QSet<IoDeviceBase *> connections;
+    for (const SourceInfo &info : qAsConst(connectedSources))
+        connections.insert(info.device);
+
+    for (IoDeviceBase *connection : qAsConst(connections)) {
+        if (connection->takeReceivedSinceHeartbeat()) {
+            connection->setHeartbeatPending(false);
+        } else if (connection->isHeartbeatPending()) {
+            qROPrivDebug() << "No heartbeat reply from" << connection << "- disconnecting";
+            connection->setHeartbeatPending(false);
+            // The source didn't respond in time, disconnect the connection
+            if (ClientIoDevice *clientIo = qobject_cast<ClientIoDevice *>(connection))
+                clientIo->disconnectFromServer();
+            else
+                connection->close();
+        } else if (connection->isOpen()) {
+            // Hosts answer a Ping with a Pong of the same name, an empty one addresses no replica
+            QRemoteObjectPackets::DataStreamPacket packet;
+            QRemoteObjectPackets::serializePingPacket(packet, QString(), 0);
+            connection->write(packet.array, packet.size);
+            connection->setHeartbeatPending(true);
+        }
+    }
+}
+
+void QRemoteObjectNodePrivate::onShouldReconnect(ClientIoDevice *ioDevice)
+{
+    replicasById.remove(ioDevice);
     const auto remoteObjects = ioDevice->remoteObjects();
     for (const QString &remoteObject : remoteObjects) {
         connectedSources.remove(remoteObject);
@@ -1214,10 +1454,13 @@ void QRemoteObjectNodePrivate::onShouldReconnect(ClientIoDevice *ioDevice)
     if (requestedUrls.contains(ioDevice->url())) {
         // Only try to reconnect to URLs requested via connectToNode
         // If we connected via registry, wait for the registry to see the node/source again
-        pendingReconnect.insert(ioDevice);
-        if (!reconnectTimer.isActive()) {
-            reconnectTimer.start(retryInterval, q);
-            qROPrivDebug() << "Starting reconnect timer";
+        if (!pendingReconnect.contains(ioDevice)) {
+            ReconnectState &state = reconnectStates[ioDevice->url()];
+            if (!state.disconnected.isValid())
+                state.disconnected.start();
+            pendingReconnect.insert(ioDevice, QDeadlineTimer(reconnectDelay(state.attempts)));
+            qROPrivDebug() << "Scheduling reconnect to" << ioDevice->url() << "attempt" << state.attempts;
+            scheduleReconnect();
         }
     } else {
         qROPrivDebug() << "Url" << ioDevice->url().toDisplayString().toLatin1()
@@ -1290,6 +1533,31 @@ QReplicaImplementationInterface *QRemoteObjectHostBasePrivate::handleNewAcquire(
     return QRemoteObjectNodePrivate::handleNewAcquire(meta, instance, name);
 }
 
+// Packets carrying an object id are resolved through the connection's id table,
+// without hashing the object name. Unknown ids fall back to the name.
+QSharedPointer<QReplicaImplementationInterface> QRemoteObjectNodePrivate::replicaForPacket(IoDeviceBase *connection)
+{
+    if (rxObjectId) {
+        const auto it = replicasById.constFind(connection);
+        if (it != replicasById.cend() && rxObjectId < quint32(it->size())) {
+            QSharedPointer<QReplicaImplementationInterface> rep = it->at(int(rxObjectId)).toStrongRef();
+            if (rep)
+                return rep;
+        }
+    }
+    return replicas.value(rxName).toStrongRef();
+}
+
+void QRemoteObjectNodePrivate::bindReplicaId(IoDeviceBase *connection, quint32 id, const QSharedPointer<QReplicaImplementationInterface> &rep)
+{
+    if (id == 0 || id > maxObjectId)
+        return;
+    QVector<QWeakPointer<QReplicaImplementationInterface>> &byId = replicasById[connection];
+    if (byId.size() <= int(id))
+        byId.resize(int(id) + 1);
+    byId[int(id)] = rep;
+}
+
 void QRemoteObjectNodePrivate::onClientRead(QObject *obj)
 {
     using namespace QRemoteObjectPackets;
@@ -1298,7 +1566,7 @@ void QRemoteObjectNodePrivate::onClientRead(QObject *obj)
     Q_ASSERT(connection);
 
     do {
-        if (!connection->read(packetType, rxName))
+        if (!connection->read(packetType, rxName, rxObjectId))
             return;
 
         if (packetType != Handshake && !m_handshakeReceived) {
@@ -1310,21 +1578,37 @@ void QRemoteObjectNodePrivate::onClientRead(QObject *obj)
 
         switch (packetType) {
         case Pong:
-        {
-            QSharedPointer<QRemoteObjectReplicaImplementation> rep = qSharedPointerCast<QRemoteObjectReplicaImplementation>(replicas.value(rxName).toStrongRef());
-            if (rep)
-                rep->notifyAboutReply(0, {});
-            else //replica has been deleted, remove from list
-                replicas.remove(rxName);
+            // Any packet counts as a heartbeat reply, see checkHeartbeats()
             break;
-        }
         case Handshake:
-            if (rxName != QtRemoteObjects::protocolVersion) {
+            if (rxName != QtRemoteObjects::protocolVersion && rxName != QtRemoteObjects::legacyProtocolVersion) {
                 qWarning() << "*** Protocol Mismatch, closing connection ***. Got" << rxName << "expected" << QtRemoteObjects::protocolVersion;
                 setLastError(QRemoteObjectNode::ProtocolMismatch);
                 connection->close();
             } else {
                 m_handshakeReceived = true;
+                if (ClientIoDevice *clientIo = qobject_cast<ClientIoDevice *>(connection)) {
+                    const auto state = reconnectStates.constFind(clientIo->url());
+                    if (state != reconnectStates.cend()) {
+                        lastReconnectLatency = state->disconnected.elapsed();
+                        maxReconnectLatency = qMax(maxReconnectLatency, lastReconnectLatency);
+                        ++reconnectCount;
+                        reconnectStates.erase(state);
+                    }
+                }
+                connection->setLegacyProtocol(rxName != QtRemoteObjects::protocolVersion);
+                quint32 capabilities = 0;
+                if (!connection->isLegacyProtocol())
+                    deserializeHandshakePacket(connection->stream(), capabilities);
+                // The host only needs an answer if it offered something
+                if (capabilities) {
+                    const quint32 accepted = m_compressionThreshold > 0 ? (capabilities & CompressionCapability) : 0;
+                    if (accepted & CompressionCapability)
+                        connection->setCompressionThreshold(m_compressionThreshold);
+                    DataStreamPacket packet;
+                    serializeHandshakePacket(packet, accepted);
+                    connection->write(packet.array, packet.size);
+                }
             }
             break;
         case ObjectList:
@@ -1354,10 +1638,34 @@ void QRemoteObjectNodePrivate::onClientRead(QObject *obj)
         {
             qROPrivDebug() << "InitPacket-->" << rxName << this;
             QSharedPointer<QConnectedReplicaImplementation> rep = qSharedPointerCast<QConnectedReplicaImplementation>(replicas.value(rxName).toStrongRef());
-            //Use m_rxArgs (a QVariantList to hold the properties QVariantList)
-            deserializeInitPacket(connection->stream(), rxArgs);
             if (rep)
             {
+                //Use m_rxArgs (a QVariantList to hold the properties QVariantList)
+                deserializeInitPacket(connection->stream(), rxArgs);
+                rep->m_objectId = rxObjectId;
+                bindReplicaId(connection, rxObjectId, rep);
+                handlePointerToQObjectProperties(rep.data(), rxArgs);
+                rep->initialize(rxArgs);
+            } else { //replica has been deleted, remove from list
+                replicas.remove(rxName);
+            }
+            break;
+        }
+        case InitDeltaPacket:
+        {
+            qROPrivDebug() << "InitDeltaPacket-->" << rxName << this;
+            QSharedPointer<QConnectedReplicaImplementation> rep = qSharedPointerCast<QConnectedReplicaImplementation>(replicas.value(rxName).toStrongRef());
+            if (rep)
+            {
+                // Start from what we have, the packet only holds properties that changed
+                rxArgs = rep->m_propertyStorage;
+                if (!deserializeInitDeltaPacket(connection->stream(), rxArgs)) {
+                    // The source doesn't agree with our properties, ask again without hashes
+                    rep->requestRemoteObjectSource(false);
+                    break;
+                }
+                rep->m_objectId = rxObjectId;
+                bindReplicaId(connection, rxObjectId, rep);
                 handlePointerToQObjectProperties(rep.data(), rxArgs);
                 rep->initialize(rxArgs);
             } else { //replica has been deleted, remove from list
@@ -1373,6 +1681,8 @@ void QRemoteObjectNodePrivate::onClientRead(QObject *obj)
             QSharedPointer<QConnectedReplicaImplementation> rep = qSharedPointerCast<QConnectedReplicaImplementation>(replicas.value(rxName).toStrongRef());
             if (rep)
             {
+                rep->m_objectId = rxObjectId;
+                bindReplicaId(connection, rxObjectId, rep);
                 rep->setDynamicMetaObject(meta);
                 handlePointerToQObjectProperties(rep.data(), rxArgs);
                 rep->setDynamicProperties(rxArgs);
@@ -1390,6 +1700,8 @@ void QRemoteObjectNodePrivate::onClientRead(QObject *obj)
                 QSharedPointer<QConnectedReplicaImplementation> rep = qSharedPointerCast<QConnectedReplicaImplementation>(replicas.value(rxName).toStrongRef());
                 if (rep && !rep->connectionToSource.isNull()) {
                     rep->connectionToSource.clear();
+                    bindReplicaId(connection, rep->m_objectId, {});
+                    rep->m_objectId = 0;
                     rep->setState(QRemoteObjectReplica::Suspect);
                 } else if (!rep) {
                     replicas.remove(rxName);
@@ -1399,10 +1711,12 @@ void QRemoteObjectNodePrivate::onClientRead(QObject *obj)
         }
         case PropertyChangePacket:
         {
-            int propertyIndex;
-            deserializePropertyChangePacket(connection->stream(), propertyIndex, rxValue);
-            QSharedPointer<QRemoteObjectReplicaImplementation> rep = qSharedPointerCast<QRemoteObjectReplicaImplementation>(replicas.value(rxName).toStrongRef());
+            // The packet is complete in the connection's buffer, so it can be dropped without
+            // decoding the value if the replica is gone
+            QSharedPointer<QRemoteObjectReplicaImplementation> rep = qSharedPointerCast<QRemoteObjectReplicaImplementation>(replicaForPacket(connection));
             if (rep) {
+                int propertyIndex;
+                deserializePropertyChangePacket(connection->stream(), propertyIndex, rxValue);
                 QConnectedReplicaImplementation *connectedRep = nullptr;
                 if (!rep->isShortCircuit()) {
                     connectedRep = static_cast<QConnectedReplicaImplementation *>(rep.data());
@@ -1428,12 +1742,33 @@ void QRemoteObjectNodePrivate::onClientRead(QObject *obj)
             }
             break;
         }
+        case CompactPropertyChangePacket:
+        {
+            // Only sent for properties of a type compactWireType() supports, to replicas that
+            // share the source's definition, so the value is read using the replica's type
+            QSharedPointer<QRemoteObjectReplicaImplementation> rep = qSharedPointerCast<QRemoteObjectReplicaImplementation>(replicaForPacket(connection));
+            if (rep) {
+                int propertyIndex;
+                deserializeCompactPropertyChangePacket(connection->stream(), propertyIndex);
+                const QMetaProperty property = rep->m_metaObject->property(propertyIndex + rep->m_metaObject->propertyOffset());
+                const int wireType = compactWireType(property.userType());
+                if (!property.isValid() || wireType == QMetaType::UnknownType
+                        || !readCompactValue(connection->stream(), rxValue, wireType, connection->packetEnd())) {
+                    qROPrivWarning() << "Invalid compact property change for" << rxName << propertyIndex;
+                    break;
+                }
+                rep->setProperty(propertyIndex, decodeVariant(rxValue, property.userType()));
+            } else { //replica has been deleted, remove from list
+                replicas.remove(rxName);
+            }
+            break;
+        }
         case InvokePacket:
         {
-            int call, index, serialId, propertyIndex;
-            deserializeInvokePacket(connection->stream(), call, index, rxArgs, serialId, propertyIndex);
-            QSharedPointer<QRemoteObjectReplicaImplementation> rep = qSharedPointerCast<QRemoteObjectReplicaImplementation>(replicas.value(rxName).toStrongRef());
+            QSharedPointer<QRemoteObjectReplicaImplementation> rep = qSharedPointerCast<QRemoteObjectReplicaImplementation>(replicaForPacket(connection));
             if (rep) {
+                int call, index, serialId, propertyIndex;
+                deserializeInvokePacket(connection->stream(), call, index, rxArgs, serialId, propertyIndex);
                 static QVariant null(QMetaType::QObjectStar, (void*)0);
                 QVariant paramValue;
                 // Qt usually supports 9 arguments, so ten should be usually safe
@@ -1465,10 +1800,10 @@ void QRemoteObjectNodePrivate::onClientRead(QObject *obj)
         }
         case InvokeReplyPacket:
         {
-            int ackedSerialId;
-            deserializeInvokeReplyPacket(connection->stream(), ackedSerialId, rxValue);
-            QSharedPointer<QRemoteObjectReplicaImplementation> rep = qSharedPointerCast<QRemoteObjectReplicaImplementation>(replicas.value(rxName).toStrongRef());
+            QSharedPointer<QRemoteObjectReplicaImplementation> rep = qSharedPointerCast<QRemoteObjectReplicaImplementation>(replicaForPacket(connection));
             if (rep) {
+                int ackedSerialId;
+                deserializeInvokeReplyPacket(connection->stream(), ackedSerialId, rxValue);
                 qROPrivDebug() << "Received InvokeReplyPacket ack'ing serial id:" << ackedSerialId;
                 rep->notifyAboutReply(ackedSerialId, rxValue);
             } else { //replica has been deleted, remove from list
@@ -1476,9 +1811,26 @@ void QRemoteObjectNodePrivate::onClientRead(QObject *obj)
             }
             break;
         }
+        case InvokeBatchReplyPacket:
+        {
+            QSharedPointer<QRemoteObjectReplicaImplementation> rep = qSharedPointerCast<QRemoteObjectReplicaImplementation>(replicaForPacket(connection));
+            if (rep) {
+                QVector<QPair<int, QVariant>> replies;
+                deserializeInvokeBatchReplyPacket(connection->stream(), replies);
+                qROPrivDebug() << "Received InvokeBatchReplyPacket with" << replies.size() << "replies";
+                for (const auto &reply : qAsConst(replies))
+                    rep->notifyAboutReply(reply.first, reply.second);
+            } else { //replica has been deleted, remove from list
+                replicas.remove(rxName);
+            }
+            break;
+        }
         case AddObject:
         case Invalid:
         case Ping:
+        case Batch: // unpacked by IoDeviceBase::read()
+        case CompressedBatch:
+        case InvokeBatchPacket:
             qROPrivWarning() << "Unexpected packet received";
         }
     } while (connection->bytesAvailable()); // have bytes left over, so do another iteration
@@ -1870,14 +2222,13 @@ bool QRemoteObjectHostBase::setHostUrl(const QUrl &hostAddress, AllowedSchemas a
         d->setLastError(HostUrlInvalid);
         return false;
     }
-    d->remoteObjectIo = new QRemoteObjectSourceIo(hostAddress, this);
+    QScopedPointer<QRemoteObjectSourceIo> sourceIo(new QRemoteObjectSourceIo(hostAddress, this));
 
-    if (allowedSchemas == AllowedSchemas::BuiltInSchemasOnly && !d->remoteObjectIo->startListening()) {
+    if (allowedSchemas == AllowedSchemas::BuiltInSchemasOnly && !sourceIo->startListening()) {
         d->setLastError(ListenFailed);
-        delete d->remoteObjectIo;
-        d->remoteObjectIo = nullptr;
         return false;
     }
+    d->setSourceIo(sourceIo.take());
 
     //If we've given a name to the node, set it on the sourceIo as well
     if (!objectName().isEmpty())
@@ -2332,7 +2683,7 @@ bool QRemoteObjectHostBase::enableRemoting(QObject *object, const QString &name)
     registered to be remoted, and \c true if remoting is successfully enabled
     for the QAbstractItemModel.
 
-    \sa disableRemoting()
+    \sa disableRemoting(), setModelDataInlineLimit()
  */
 bool QRemoteObjectHostBase::enableRemoting(QAbstractItemModel *model, const QString &name, const QVector<int> roles, QItemSelectionModel *selectionModel)
 {
@@ -2345,6 +2696,8 @@ bool QRemoteObjectHostBase::enableRemoting(QAbstractItemModel *model, const QStr
         new QAbstractItemAdapterSourceAPI<QAbstractItemModel, QAbstractItemModelSourceAdapter>(name);
     if (!this->objectName().isEmpty())
         adapter->setObjectName(this->objectName().append(QLatin1String("Adapter")));
+    Q_D(const QRemoteObjectHostBase);
+    static_cast<QAbstractItemModelSourceAdapter *>(adapter)->setInlineDataLimit(d->modelDataInlineLimit);
     return enableRemoting(model, api, adapter);
 }
 
@@ -2432,6 +2785,313 @@ bool QRemoteObjectHostBase::disableRemoting(QObject *remoteObject)
     return true;
 }
 
+/*!
+    \since 6.0
+
+    Enables or disables conflation of property changes for the remoted QObject
+    \a remoteObject, depending on \a enable. Conflation is disabled by default.
+
+    With conflation enabled, a property change that has not been sent to a
+    connected node yet is replaced by a later change of the same property. As
+    long as the connection can't keep up, changes are held back, so a slow
+    node only receives the most recent value of each property instead of all
+    intermediate values. This bounds the memory used per connection and keeps
+    the node at most one value behind. The notify signal is emitted on the
+    \l Replica only for the values it actually receives.
+
+    Returns \c false if the current node is a client node or if \a remoteObject
+    is not registered, and \c true otherwise.
+
+    \sa enableRemoting()
+*/
+bool QRemoteObjectHostBase::setPropertyConflationEnabled(QObject *remoteObject, bool enable)
+{
+    Q_D(QRemoteObjectHostBase);
+    if (!d->remoteObjectIo) {
+        d->setLastError(OperationNotValidOnClientNode);
+        return false;
+    }
+
+    QRemoteObjectRootSource *source = d->remoteObjectIo->m_objectToSourceMap.value(remoteObject);
+    if (!source) {
+        d->setLastError(SourceNotRegistered);
+        return false;
+    }
+
+    source->d->conflatePropertyChanges = enable;
+    return true;
+}
+
+/*!
+    \since 6.0
+    \enum QRemoteObjectHostBase::SendQueuePolicy
+
+    This enum describes how a host node reacts when more data is queued for a
+    connected node than the limits set with setSendQueueLimits() allow.
+
+    \value DropOldestPackets The oldest queued signals are dropped until the
+        queue is back at the low watermark. Property changes are only dropped
+        if a newer value of the same property is queued, so Replicas can miss
+        intermediate values, but not the latest one.
+    \value ConflatePropertyChanges Queued changes of the same property are
+        replaced by the latest value, as if setPropertyConflationEnabled() was
+        called for all Source objects, until the queue is back at the low
+        watermark.
+    \value DisconnectClient The connection to the node is closed.
+    \value SuspendClient Nothing is sent to the node for the Source objects
+        it has acquired a Replica of, until the queue is back at the low
+        watermark. The properties that changed meanwhile are sent then, with
+        their notify signals. Other signals emitted meanwhile do not reach the
+        node. Models are not suspended.
+*/
+
+/*!
+    \since 6.0
+
+    Limits the data queued for each connected node. Once more than \a
+    highWatermark bytes are waiting to be sent to a node,
+    sendQueueHighWatermarkReached() is emitted, no more data is handed to the
+    connection until it has drained down to \a lowWatermark bytes, and \a
+    policy is applied. sendQueueLowWatermarkReached() is emitted once the
+    connection has drained.
+
+    Only \l {QRemoteObjectHostBase::}{DropOldestPackets} keeps the data held
+    back for a congested node bounded by itself. With the other policies, a
+    node for which more than four times \a highWatermark bytes are held back
+    is disconnected.
+
+    A \a highWatermark of 0, the default, disables the limits.
+
+    \sa queuedBytes(), droppedPacketCount(), backpressureDisconnectCount()
+*/
+void QRemoteObjectHostBase::setSendQueueLimits(qint64 highWatermark, qint64 lowWatermark, SendQueuePolicy policy)
+{
+    Q_D(QRemoteObjectHostBase);
+    d->sendQueueHighWatermark = highWatermark;
+    d->sendQueueLowWatermark = lowWatermark;
+    d->sendQueuePolicy = policy;
+    if (d->remoteObjectIo)
+        d->remoteObjectIo->setSendQueueLimits(highWatermark, lowWatermark, policy);
+}
+
+/*!
+    \since 6.0
+
+    Returns the number of bytes currently waiting to be sent to each connected
+    node, keyed by the client id also used by sendQueueHighWatermarkReached().
+*/
+QHash<int, qint64> QRemoteObjectHostBase::queuedBytes() const
+{
+    Q_D(const QRemoteObjectHostBase);
+    QHash<int, qint64> queued;
+    if (!d->remoteObjectIo)
+        return queued;
+    for (auto it = d->remoteObjectIo->m_clientIds.cbegin(), end = d->remoteObjectIo->m_clientIds.cend(); it != end; ++it)
+        queued.insert(it.value(), it.key()->queuedBytes());
+    return queued;
+}
+
+/*!
+    \since 6.0
+
+    Returns the number of packets dropped so far because of the
+    \l {QRemoteObjectHostBase::}{DropOldestPackets} policy.
+
+    \sa setSendQueueLimits()
+*/
+quint64 QRemoteObjectHostBase::droppedPacketCount() const
+{
+    Q_D(const QRemoteObjectHostBase);
+    return d->remoteObjectIo ? d->remoteObjectIo->m_droppedPackets : 0;
+}
+
+/*!
+    \since 6.0
+
+    Returns the number of nodes disconnected so far because of the
+    \l {QRemoteObjectHostBase::}{DisconnectClient} policy, or because too much
+    data was held back for them, see setSendQueueLimits().
+
+    \sa setSendQueueLimits()
+*/
+quint64 QRemoteObjectHostBase::backpressureDisconnectCount() const
+{
+    Q_D(const QRemoteObjectHostBase);
+    return d->remoteObjectIo ? d->remoteObjectIo->m_backpressureDisconnects : 0;
+}
+
+/*!
+    \since 6.0
+
+    Sets whether the sockets of nodes connecting to this host are read and
+    written on a dedicated thread, to \a enabled. The default is \c false.
+
+    With the I/O thread, a busy thread owning this node (like a GUI thread
+    painting) no longer delays reading from and writing to the sockets. The
+    received data is also split into packets there, so the thread owning
+    this node is only woken for complete packets. Encoding and decoding the
+    packets, and the Source objects, stay on the thread owning this node.
+
+    Only affects connections accepted afterwards, and only those of the
+    \c tcp and \c local schemes. Connections added with
+    addHostSideConnection() are never moved.
+
+    \sa setIoThreadCount()
+*/
+void QRemoteObjectHostBase::setIoThreadEnabled(bool enabled)
+{
+    Q_D(QRemoteObjectHostBase);
+    d->ioThreadEnabled = enabled;
+    if (d->remoteObjectIo)
+        d->remoteObjectIo->m_ioThreadEnabled = enabled;
+}
+
+/*!
+    \since 6.0
+
+    Returns whether the sockets of connecting nodes are handled on a
+    dedicated thread.
+
+    \sa setIoThreadEnabled()
+*/
+bool QRemoteObjectHostBase::isIoThreadEnabled() const
+{
+    Q_D(const QRemoteObjectHostBase);
+    return d->ioThreadEnabled;
+}
+
+/*!
+    \since 6.0
+
+    Sets the number of I/O threads the connections are distributed across to
+    \a count, if setIoThreadEnabled() is set. The default is 1.
+
+    Each accepted connection is handed to the thread currently serving the
+    fewest connections. Threads are only started once all running ones serve
+    a connection. Packets sent to several nodes, like property changes, are
+    still only encoded once, on the thread owning this node, and then written
+    to the sockets by their I/O threads.
+
+    Connections keep their thread. Lowering the count does not stop threads
+    that were already started.
+*/
+void QRemoteObjectHostBase::setIoThreadCount(int count)
+{
+    Q_D(QRemoteObjectHostBase);
+    d->ioThreadCount = qMax(count, 1);
+    if (d->remoteObjectIo)
+        d->remoteObjectIo->m_ioThreadCount = d->ioThreadCount;
+}
+
+/*!
+    \since 6.0
+
+    Returns the number of I/O threads connections are distributed across.
+
+    \sa setIoThreadCount(), setIoThreadEnabled()
+*/
+int QRemoteObjectHostBase::ioThreadCount() const
+{
+    Q_D(const QRemoteObjectHostBase);
+    return d->ioThreadCount;
+}
+
+/*!
+    \since 6.0
+
+    Limits the number of nodes being greeted at the same time to \a count.
+    A value of 0, the default, means no limit.
+
+    When a host restarts, all nodes that were connected to it reconnect and
+    acquire their replicas again. With a limit, connections accepted while
+    \a count nodes have not yet been sent the initial property values of the
+    first replica they acquired wait until one of them was, or until one of
+    them acquired nothing for five seconds. This spreads the work of sending
+    the initial property values over time.
+
+    \sa QRemoteObjectNode::reconnectCount()
+*/
+void QRemoteObjectHostBase::setMaxConcurrentHandshakes(int count)
+{
+    Q_D(QRemoteObjectHostBase);
+    d->maxConcurrentHandshakes = qMax(count, 0);
+    if (d->remoteObjectIo)
+        d->remoteObjectIo->setMaxConcurrentHandshakes(d->maxConcurrentHandshakes);
+}
+
+/*!
+    \since 6.0
+
+    Returns the number of nodes that can be greeted at the same time, 0 if
+    there is no limit.
+
+    \sa setMaxConcurrentHandshakes()
+*/
+int QRemoteObjectHostBase::maxConcurrentHandshakes() const
+{
+    Q_D(const QRemoteObjectHostBase);
+    return d->maxConcurrentHandshakes;
+}
+
+/*!
+    \since 6.0
+
+    Sets the number of cells up to which a model shared with enableRemoting()
+    sends the new values along with its QAbstractItemModel::dataChanged()
+    notifications to \a cells. A value of 0, the default, means values are
+    never sent.
+
+    By default, replicas drop the changed cells from their cache and fetch them
+    again, which takes another round trip for each change. With a limit, a
+    change to at most \a cells cells updates the cached cells of the replicas
+    directly. Larger changes are still fetched again.
+
+    The limit only applies to models shared after this call. All nodes that
+    acquire these models must use a Qt Remote Objects version that supports
+    this.
+
+    \sa modelDataInlineLimit()
+*/
+void QRemoteObjectHostBase::setModelDataInlineLimit(int cells)
+{
+    Q_D(QRemoteObjectHostBase);
+    d->modelDataInlineLimit = qMax(cells, 0);
+}
+
+/*!
+    \since 6.0
+
+    Returns the number of cells up to which shared models send the new values
+    along with their QAbstractItemModel::dataChanged() notifications, 0 if they
+    never do.
+
+    \sa setModelDataInlineLimit()
+*/
+int QRemoteObjectHostBase::modelDataInlineLimit() const
+{
+    Q_D(const QRemoteObjectHostBase);
+    return d->modelDataInlineLimit;
+}
+
+/*!
+    \fn void QRemoteObjectHostBase::sendQueueHighWatermarkReached(int clientId, qint64 queuedBytes)
+    \since 6.0
+
+    This signal is emitted when more data than the high watermark set with
+    setSendQueueLimits() is queued for the node identified by \a clientId.
+    \a queuedBytes is the amount of data currently queued for it.
+*/
+
+/*!
+    \fn void QRemoteObjectHostBase::sendQueueLowWatermarkReached(int clientId, qint64 queuedBytes)
+    \since 6.0
+
+    This signal is emitted when the connection to the node identified by \a
+    clientId has drained to the low watermark after
+    sendQueueHighWatermarkReached() was emitted. \a queuedBytes is the amount
+    of data currently queued for it.
+*/
+
 /*!
     \since 5.12
 
@@ -2452,7 +3112,7 @@ void QRemoteObjectHostBase::addHostSideConnection(QIODevice *ioDevice)
 {
     Q_D(QRemoteObjectHostBase);
     if (!d->remoteObjectIo)
-        d->remoteObjectIo = new QRemoteObjectSourceIo(this);
+        d->setSourceIo(new QRemoteObjectSourceIo(this));
     ExternalIoDevice *device = new ExternalIoDevice(ioDevice, this);
     return d->remoteObjectIo->newConnection(device);
 }
@@ -2475,6 +3135,19 @@ QRemoteObjectHostBasePrivate::QRemoteObjectHostBasePrivate()
     , remoteObjectIo(nullptr)
 { }
 
+void QRemoteObjectHostBasePrivate::setSourceIo(QRemoteObjectSourceIo *sourceIo)
+{
+    Q_Q(QRemoteObjectHostBase);
+    remoteObjectIo = sourceIo;
+    remoteObjectIo->setSendQueueLimits(sendQueueHighWatermark, sendQueueLowWatermark, sendQueuePolicy);
+    remoteObjectIo->m_compressionThreshold = m_compressionThreshold;
+    remoteObjectIo->m_ioThreadEnabled = ioThreadEnabled;
+    remoteObjectIo->m_ioThreadCount = ioThreadCount;
+    remoteObjectIo->setMaxConcurrentHandshakes(maxConcurrentHandshakes);
+    QObject::connect(remoteObjectIo, &QRemoteObjectSourceIo::sendQueueHighWatermarkReached, q, &QRemoteObjectHostBase::sendQueueHighWatermarkReached);
+    QObject::connect(remoteObjectIo, &QRemoteObjectSourceIo::sendQueueLowWatermarkReached, q, &QRemoteObjectHostBase::sendQueueLowWatermarkReached);
+}
+
 QRemoteObjectHostBasePrivate::~QRemoteObjectHostBasePrivate()
 { }
 
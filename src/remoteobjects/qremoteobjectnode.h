@@ -42,6 +42,7 @@
 
 #include <QtCore/qsharedpointer.h>
 #include <QtCore/qmetaobject.h>
+#include <QtCore/qhash.h>
 #include <QtRemoteObjects/qtremoteobjectglobal.h>
 #include <QtRemoteObjects/qremoteobjectregistry.h>
 #include <QtRemoteObjects/qremoteobjectdynamicreplica.h>
@@ -83,6 +84,7 @@ class Q_REMOTEOBJECTS_EXPORT QRemoteObjectNode : public QObject
     Q_PROPERTY(QUrl registryUrl READ registryUrl WRITE setRegistryUrl)
     Q_PROPERTY(QRemoteObjectAbstractPersistedStore* persistedStore READ persistedStore WRITE setPersistedStore)
     Q_PROPERTY(int heartbeatInterval READ heartbeatInterval WRITE setHeartbeatInterval NOTIFY heartbeatIntervalChanged)
+    Q_PROPERTY(int compressionThreshold READ compressionThreshold WRITE setCompressionThreshold NOTIFY compressionThresholdChanged)
 
 public:
     enum ErrorCode{
@@ -142,6 +144,18 @@ public:
     int heartbeatInterval() const;
     void setHeartbeatInterval(int interval);
 
+    int compressionThreshold() const;
+    void setCompressionThreshold(int bytes);
+
+    int callTimeout() const;
+    void setCallTimeout(int msecs);
+    int maxPendingCalls() const;
+    void setMaxPendingCalls(int count);
+
+    quint64 reconnectCount() const;
+    qint64 lastReconnectLatency() const;
+    qint64 maxReconnectLatency() const;
+
     typedef std::function<void (QUrl)> RemoteObjectSchemaHandler;
     void registerExternalSchema(const QString &schema, RemoteObjectSchemaHandler handler);
 
@@ -151,6 +165,7 @@ Q_SIGNALS:
 
     void error(QRemoteObjectNode::ErrorCode errorCode);
     void heartbeatIntervalChanged(int heartbeatInterval);
+    void compressionThresholdChanged(int compressionThreshold);
 
 protected:
     QRemoteObjectNode(QRemoteObjectNodePrivate &, QObject *parent);
@@ -172,6 +187,13 @@ class Q_REMOTEOBJECTS_EXPORT QRemoteObjectHostBase : public QRemoteObjectNode
 public:
     enum AllowedSchemas { BuiltInSchemasOnly, AllowExternalRegistration };
     Q_ENUM(AllowedSchemas)
+    enum SendQueuePolicy {
+        DropOldestPackets,
+        ConflatePropertyChanges,
+        DisconnectClient,
+        SuspendClient
+    };
+    Q_ENUM(SendQueuePolicy)
     ~QRemoteObjectHostBase() override;
     void setName(const QString &name) override;
 
@@ -184,8 +206,25 @@ public:
     Q_INVOKABLE bool enableRemoting(QObject *object, const QString &name = QString());
     bool enableRemoting(QAbstractItemModel *model, const QString &name, const QVector<int> roles, QItemSelectionModel *selectionModel = nullptr);
     Q_INVOKABLE bool disableRemoting(QObject *remoteObject);
+    bool setPropertyConflationEnabled(QObject *remoteObject, bool enable);
     void addHostSideConnection(QIODevice *ioDevice);
 
+    void setSendQueueLimits(qint64 highWatermark, qint64 lowWatermark, SendQueuePolicy policy);
+    QHash<int, qint64> queuedBytes() const;
+    quint64 droppedPacketCount() const;
+    quint64 backpressureDisconnectCount() const;
+
+    void setIoThreadEnabled(bool enabled);
+    bool isIoThreadEnabled() const;
+    void setIoThreadCount(int count);
+    int ioThreadCount() const;
+
+    void setMaxConcurrentHandshakes(int count);
+    int maxConcurrentHandshakes() const;
+
+    void setModelDataInlineLimit(int cells);
+    int modelDataInlineLimit() const;
+
     typedef std::function<bool(const QString &, const QString &)> RemoteObjectNameFilter;
     bool proxy(const QUrl &registryUrl, const QUrl &hostUrl={},
                RemoteObjectNameFilter filter=[](const QString &, const QString &) {return true; });
@@ -193,6 +232,10 @@ public:
     // reverse aspect requires the registry.
     bool reverseProxy(RemoteObjectNameFilter filter=[](const QString &, const QString &) {return true; });
 
+Q_SIGNALS:
+    void sendQueueHighWatermarkReached(int clientId, qint64 queuedBytes);
+    void sendQueueLowWatermarkReached(int clientId, qint64 queuedBytes);
+
 protected:
     virtual QUrl hostUrl() const;
     virtual bool setHostUrl(const QUrl &hostAddress, AllowedSchemas allowedSchemas=BuiltInSchemasOnly);
@@ -57,6 +57,8 @@
 #include "qremoteobjectnode.h"
 
 #include <QtCore/qbasictimer.h>
+#include <QtCore/qdeadlinetimer.h>
+#include <QtCore/qelapsedtimer.h>
 #include <QtCore/qmutex.h>
 
 QT_BEGIN_NAMESPACE
@@ -151,10 +153,15 @@ public:
     void handlePointerToQObjectProperties(QConnectedReplicaImplementation *rep, QVariantList &properties);
 
     void onClientRead(QObject *obj);
+    QSharedPointer<QReplicaImplementationInterface> replicaForPacket(IoDeviceBase *connection);
+    void bindReplicaId(IoDeviceBase *connection, quint32 id, const QSharedPointer<QReplicaImplementationInterface> &rep);
     void onRemoteObjectSourceAdded(const QRemoteObjectSourceLocation &entry);
     void onRemoteObjectSourceRemoved(const QRemoteObjectSourceLocation &entry);
     void onRegistryInitialized();
     void onShouldReconnect(ClientIoDevice *ioDevice);
+    int reconnectDelay(int attempts) const;
+    void scheduleReconnect();
+    void checkHeartbeats();
 
     virtual QReplicaImplementationInterface *handleNewAcquire(const QMetaObject *meta, QRemoteObjectReplica *instance, const QString &name);
     void handleReplicaConnection(const QString &name);
@@ -174,21 +181,39 @@ public:
     QMutex mutex;
     QUrl registryAddress;
     QHash<QString, QWeakPointer<QReplicaImplementationInterface> > replicas;
+    // Per connection, indexed by the object ids the host announced in Init packets
+    QHash<IoDeviceBase *, QVector<QWeakPointer<QReplicaImplementationInterface>>> replicasById;
     QMap<QString, SourceInfo> connectedSources;
     QMap<QString, QRemoteObjectNode::RemoteObjectSchemaHandler> schemaHandlers;
-    QSet<ClientIoDevice*> pendingReconnect;
+    struct ReconnectState
+    {
+        int attempts = 0;
+        QElapsedTimer disconnected; // since the connection was lost
+    };
+
+    QHash<ClientIoDevice*, QDeadlineTimer> pendingReconnect; // when to try connecting again
+    QHash<QUrl, ReconnectState> reconnectStates; // of requested urls, until they are connected again
     QSet<QUrl> requestedUrls;
     QRemoteObjectRegistry *registry;
     int retryInterval;
+    int maxRetryInterval = 30000;
     QBasicTimer reconnectTimer;
+    QBasicTimer heartbeatTimer; // one Ping per connection to a source, see checkHeartbeats()
+    quint64 reconnectCount = 0;
+    qint64 lastReconnectLatency = 0;
+    qint64 maxReconnectLatency = 0;
     QRemoteObjectNode::ErrorCode lastError;
     QString rxName;
+    quint32 rxObjectId = 0;
     QRemoteObjectPackets::ObjectInfoList rxObjects;
     QVariantList rxArgs;
     QVariant rxValue;
     QRemoteObjectAbstractPersistedStore *persistedStore;
     bool m_handshakeReceived = false;
     int m_heartbeatInterval = 0;
+    int m_compressionThreshold = 0;
+    int m_callTimeout = 0;
+    int m_maxPendingCalls = 1024; // PendingCallSlab::defaultCapacity
     QRemoteObjectMetaObjectManager dynamicTypeManager;
     Q_DECLARE_PUBLIC(QRemoteObjectNode)
 };
@@ -200,9 +225,18 @@ public:
     ~QRemoteObjectHostBasePrivate() override;
     QReplicaImplementationInterface *handleNewAcquire(const QMetaObject *meta, QRemoteObjectReplica *instance, const QString &name) override;
 
+    void setSourceIo(QRemoteObjectSourceIo *sourceIo);
+
 public:
     QRemoteObjectSourceIo *remoteObjectIo;
     ProxyInfo *proxyInfo = nullptr;
+    qint64 sendQueueHighWatermark = 0;
+    qint64 sendQueueLowWatermark = 0;
+    QRemoteObjectHostBase::SendQueuePolicy sendQueuePolicy = QRemoteObjectHostBase::DropOldestPackets;
+    bool ioThreadEnabled = false;
+    int ioThreadCount = 1;
+    int maxConcurrentHandshakes = 0;
+    int modelDataInlineLimit = 0;
     Q_DECLARE_PUBLIC(QRemoteObjectHostBase);
 };
 
@@ -40,6 +40,7 @@
 #include "qremoteobjectpacket_p.h"
 
 #include <QtCore/qabstractitemmodel.h>
+#include <QtCore/qvarlengtharray.h>
 
 #include "qremoteobjectpendingcall.h"
 #include "qremoteobjectsource.h"
@@ -160,17 +161,47 @@ void serializeProperty(QDataStream &ds, const QRemoteObjectSourceBase *source, i
     ds << encodeVariant(value);
 }
 
-void serializeHandshakePacket(DataStreamPacket &ds)
+// Packets on the hot path refer to their object by the id announced in its Init packet, when
+// there is one, instead of repeating the object name every time.
+static void setIdAndObject(DataStreamPacket &ds, QRemoteObjectPacketTypeEnum type, const QString &name, quint32 objectId)
+{
+    if (objectId) {
+        ds.setId(type | objectIdFlag);
+        writeVarint(ds, objectId);
+    } else {
+        ds.setId(type);
+        ds << name;
+    }
+}
+
+static void setIdAndAnnounceObject(DataStreamPacket &ds, QRemoteObjectPacketTypeEnum type, const QRemoteObjectRootSource *source)
+{
+    const quint32 objectId = source->objectId();
+    ds.setId(objectId ? type | objectIdFlag : type);
+    ds << source->name();
+    if (objectId)
+        writeVarint(ds, objectId);
+}
+
+void serializeHandshakePacket(DataStreamPacket &ds, quint32 capabilities)
 {
     ds.setId(Handshake);
     ds << QString(protocolVersion);
+    ds << capabilities;
     ds.finishPacket();
 }
 
+// The protocol version has already been read as the packet's name
+void deserializeHandshakePacket(QDataStream &in, quint32 &capabilities)
+{
+    in >> capabilities;
+    if (in.status() != QDataStream::Ok)
+        capabilities = 0;
+}
+
 void serializeInitPacket(DataStreamPacket &ds, const QRemoteObjectRootSource *source)
 {
-    ds.setId(InitPacket);
-    ds << source->name();
+    setIdAndAnnounceObject(ds, InitPacket, source);
     serializeProperties(ds, source);
     ds.finishPacket();
 }
@@ -199,21 +230,19 @@ bool deserializeQVariantList(QDataStream &s, QList<QVariant> &l)
         for (int i = c; i < initialListSize; ++i)
             l.removeLast();
 
+    // Decode in place, so we don't pay for a temporary and a copy per element
     for (int i = 0; i < l.size(); ++i)
     {
         if (s.atEnd())
             return false;
-        QVariant t;
-        s >> t;
-        l[i] = t;
+        s >> l[i];
     }
     for (quint32 i = l.size(); i < c; ++i)
     {
         if (s.atEnd())
             return false;
-        QVariant t;
-        s >> t;
-        l.append(t);
+        l.append(QVariant());
+        s >> l.last();
     }
     return true;
 }
@@ -227,8 +256,7 @@ void deserializeInitPacket(QDataStream &in, QVariantList &values)
 
 void serializeInitDynamicPacket(DataStreamPacket &ds, const QRemoteObjectRootSource *source)
 {
-    ds.setId(InitDynamicPacket);
-    ds << source->name();
+    setIdAndAnnounceObject(ds, InitDynamicPacket, source);
     serializeDefinition(ds, source);
     serializeProperties(ds, source);
     ds.finishPacket();
@@ -559,17 +587,80 @@ void serializeDefinition(QDataStream &ds, const QRemoteObjectSourceBase *source)
     }
 }
 
-void serializeAddObjectPacket(DataStreamPacket &ds, const QString &name, bool isDynamic)
+quint64 propertyHash(const QVariant &value)
+{
+    QByteArray encoded;
+    QDataStream ds(&encoded, QIODevice::WriteOnly);
+    ds.setVersion(dataStreamVersion);
+    ds << encodeVariant(value);
+    // A collision would leave a stale value on the replica, so use two independent 32 bit hashes
+    return (quint64(quint32(qHashBits(encoded.constData(), size_t(encoded.size()), 0x9e3779b9))) << 32)
+            | quint32(qHashBits(encoded.constData(), size_t(encoded.size()), 0x85ebca6b));
+}
+
+void serializeInitDeltaPacket(DataStreamPacket &ds, const QRemoteObjectRootSource *source, const QVector<quint64> &propertyHashes)
+{
+    const SourceApiMap *api = source->m_api;
+    const int numProperties = api->propertyCount();
+    Q_ASSERT(propertyHashes.size() == numProperties);
+
+    QVarLengthArray<quint32> changed;
+    for (int internalIndex = 0; internalIndex < numProperties; ++internalIndex) {
+        const auto target = api->isAdapterProperty(internalIndex) ? source->m_adapter : source->m_object;
+        const auto property = target->metaObject()->property(api->sourcePropertyIndex(internalIndex));
+        // Child objects are always sent, the replica needs them to reinitialize its children
+        if (QMetaType::typeFlags(property.userType()).testFlag(QMetaType::PointerToQObject)
+                || propertyHash(property.read(target)) != propertyHashes.at(internalIndex))
+            changed.append(quint32(internalIndex));
+    }
+
+    setIdAndAnnounceObject(ds, InitDeltaPacket, source);
+    ds << quint32(numProperties);
+    ds << quint32(changed.size());
+    for (const quint32 internalIndex : changed) {
+        ds << internalIndex;
+        serializeProperty(ds, source, int(internalIndex));
+    }
+    ds.finishPacket();
+}
+
+// values has to hold the replica's current properties, the changed ones are replaced.
+// Returns false if the packet doesn't match the replica, values must not be used then.
+bool deserializeInitDeltaPacket(QDataStream &in, QVariantList &values)
+{
+    quint32 numProperties, changed;
+    in >> numProperties >> changed;
+    if (numProperties != quint32(values.size())) {
+        qCWarning(QT_REMOTEOBJECT) << "Property count mismatch in InitDeltaPacket" << numProperties << values.size();
+        return false;
+    }
+    for (quint32 i = 0; i < changed; ++i) {
+        quint32 internalIndex;
+        in >> internalIndex;
+        if (internalIndex >= numProperties) {
+            qCWarning(QT_REMOTEOBJECT) << "Invalid property index in InitDeltaPacket" << internalIndex;
+            return false;
+        }
+        in >> values[int(internalIndex)];
+    }
+    return in.status() == QDataStream::Ok;
+}
+
+void serializeAddObjectPacket(DataStreamPacket &ds, const QString &name, bool isDynamic, const QVector<quint64> *propertyHashes)
 {
     ds.setId(AddObject);
     ds << name;
     ds << isDynamic;
+    // Legacy hosts don't expect property hashes
+    if (propertyHashes)
+        ds << *propertyHashes;
     ds.finishPacket();
 }
 
-void deserializeAddObjectPacket(QDataStream &ds, bool &isDynamic)
+void deserializeAddObjectPacket(QDataStream &ds, bool &isDynamic, QVector<quint64> &propertyHashes)
 {
     ds >> isDynamic;
+    ds >> propertyHashes;
 }
 
 void serializeRemoveObjectPacket(DataStreamPacket &ds, const QString &name)
@@ -580,10 +671,15 @@ void serializeRemoveObjectPacket(DataStreamPacket &ds, const QString &name)
 }
 //There is no deserializeRemoveObjectPacket - no parameters other than id and name
 
-void serializeInvokePacket(DataStreamPacket &ds, const QString &name, int call, int index, const QVariantList &args, int serialId, int propertyIndex)
+void serializeInvokePacket(DataStreamPacket &ds, const QString &name, quint32 objectId, int call, int index, const QVariantList &args, int serialId, int propertyIndex)
+{
+    setIdAndObject(ds, InvokePacket, name, objectId);
+    serializeInvokeCall(ds, call, index, args, serialId, propertyIndex);
+    ds.finishPacket();
+}
+
+void serializeInvokeCall(QDataStream &ds, int call, int index, const QVariantList &args, int serialId, int propertyIndex)
 {
-    ds.setId(InvokePacket);
-    ds << name;
     ds << call;
     ds << index;
 
@@ -593,7 +689,6 @@ void serializeInvokePacket(DataStreamPacket &ds, const QString &name, int call,
 
     ds << serialId;
     ds << propertyIndex;
-    ds.finishPacket();
 }
 
 void deserializeInvokePacket(QDataStream& in, int &call, int &index, QVariantList &args, int &serialId, int &propertyIndex)
@@ -607,10 +702,9 @@ void deserializeInvokePacket(QDataStream& in, int &call, int &index, QVariantLis
     in >> propertyIndex;
 }
 
-void serializeInvokeReplyPacket(DataStreamPacket &ds, const QString &name, int ackedSerialId, const QVariant &value)
+void serializeInvokeReplyPacket(DataStreamPacket &ds, const QString &name, quint32 objectId, int ackedSerialId, const QVariant &value)
 {
-    ds.setId(InvokeReplyPacket);
-    ds << name;
+    setIdAndObject(ds, InvokeReplyPacket, name, objectId);
     ds << ackedSerialId;
     ds << value;
     ds.finishPacket();
@@ -621,12 +715,242 @@ void deserializeInvokeReplyPacket(QDataStream& in, int &ackedSerialId, QVariant
     in >> value;
 }
 
+void serializeInvokeBatchPacket(DataStreamPacket &ds, const QString &name, quint32 objectId, quint32 count, const QByteArray &calls)
+{
+    setIdAndObject(ds, InvokeBatchPacket, name, objectId);
+    ds << count;
+    ds.writeRawData(calls.constData(), calls.size());
+    ds.finishPacket();
+}
+
+// The calls follow, each to be read with deserializeInvokePacket()
+void deserializeInvokeBatchPacket(QDataStream &in, quint32 &count)
+{
+    in >> count;
+}
+
+void serializeInvokeBatchReplyPacket(DataStreamPacket &ds, const QString &name, quint32 objectId, const QVector<QPair<int, QVariant>> &replies)
+{
+    setIdAndObject(ds, InvokeBatchReplyPacket, name, objectId);
+    ds << quint32(replies.size());
+    for (const auto &reply : replies)
+        ds << reply.first << reply.second;
+    ds.finishPacket();
+}
+
+void deserializeInvokeBatchReplyPacket(QDataStream &in, QVector<QPair<int, QVariant>> &replies)
+{
+    quint32 count;
+    in >> count;
+    replies.clear();
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        int ackedSerialId;
+        QVariant value;
+        in >> ackedSerialId >> value;
+        if (in.status() == QDataStream::Ok)
+            replies.append(qMakePair(ackedSerialId, value));
+    }
+}
+
+/*!
+    \internal
+    Returns the type \a userType is written as by writeCompactValue(), or
+    QMetaType::UnknownType if values of that type need the QVariant envelope.
+    Enumerations are sent as integers of the same size, like encodeVariant()
+    does.
+*/
+int compactWireType(int userType)
+{
+    switch (userType) {
+    case QMetaType::Bool:
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+    case QMetaType::Short:
+    case QMetaType::UShort:
+    case QMetaType::Char:
+    case QMetaType::SChar:
+    case QMetaType::UChar:
+    case QMetaType::Double:
+    case QMetaType::Float:
+    case QMetaType::QString:
+    case QMetaType::QByteArray:
+        return userType;
+    default:
+        break;
+    }
+    if (QMetaType::typeFlags(userType).testFlag(QMetaType::IsEnumeration)) {
+        switch (QMetaType(userType).sizeOf()) {
+        case 1: return QMetaType::Char;
+        case 2: return QMetaType::Short;
+        case 4: return QMetaType::Int;
+        default: break;
+        }
+    }
+    return QMetaType::UnknownType;
+}
+
+// Signed values are zigzag encoded, so small negative numbers stay short
+static inline quint64 zigzagEncode(qint64 value)
+{
+    return (quint64(value) << 1) ^ quint64(value >> 63);
+}
+
+static inline qint64 zigzagDecode(quint64 value)
+{
+    return qint64(value >> 1) ^ -qint64(value & 1);
+}
+
+void writeCompactValue(QDataStream &ds, const QVariant &value, int wireType)
+{
+    switch (wireType) {
+    case QMetaType::Bool:
+        ds << quint8(value.toBool());
+        break;
+    case QMetaType::Int:
+    case QMetaType::LongLong:
+    case QMetaType::Short:
+    case QMetaType::Char:
+    case QMetaType::SChar:
+        writeVarint64(ds, zigzagEncode(value.toLongLong()));
+        break;
+    case QMetaType::UInt:
+    case QMetaType::ULongLong:
+    case QMetaType::UShort:
+    case QMetaType::UChar:
+        writeVarint64(ds, value.toULongLong());
+        break;
+    case QMetaType::Double:
+    {
+        const double d = value.toDouble();
+        quint64 bits;
+        memcpy(&bits, &d, sizeof(bits));
+        ds << bits;
+        break;
+    }
+    case QMetaType::Float:
+    {
+        const float f = value.toFloat();
+        quint32 bits;
+        memcpy(&bits, &f, sizeof(bits));
+        ds << bits;
+        break;
+    }
+    case QMetaType::QString:
+    {
+        const QByteArray utf8 = value.toString().toUtf8();
+        writeVarint(ds, quint32(utf8.size()));
+        ds.writeRawData(utf8.constData(), utf8.size());
+        break;
+    }
+    case QMetaType::QByteArray:
+    {
+        const QByteArray bytes = value.toByteArray();
+        writeVarint(ds, quint32(bytes.size()));
+        ds.writeRawData(bytes.constData(), bytes.size());
+        break;
+    }
+    default:
+        Q_UNREACHABLE();
+    }
+}
+
+bool readCompactValue(QDataStream &ds, QVariant &value, int wireType, qint64 packetEnd)
+{
+    switch (wireType) {
+    case QMetaType::Bool:
+    {
+        quint8 b;
+        ds >> b;
+        value = QVariant(bool(b));
+        break;
+    }
+    case QMetaType::Int:
+    case QMetaType::LongLong:
+    case QMetaType::Short:
+    case QMetaType::Char:
+    case QMetaType::SChar:
+    {
+        quint64 v;
+        readVarint64(ds, v);
+        value = QVariant(qlonglong(zigzagDecode(v)));
+        value.convert(wireType);
+        break;
+    }
+    case QMetaType::UInt:
+    case QMetaType::ULongLong:
+    case QMetaType::UShort:
+    case QMetaType::UChar:
+    {
+        quint64 v;
+        readVarint64(ds, v);
+        value = QVariant(qulonglong(v));
+        value.convert(wireType);
+        break;
+    }
+    case QMetaType::Double:
+    {
+        quint64 bits;
+        ds >> bits;
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        value = QVariant(d);
+        break;
+    }
+    case QMetaType::Float:
+    {
+        quint32 bits;
+        ds >> bits;
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        value = QVariant(f);
+        break;
+    }
+    case QMetaType::QString:
+    case QMetaType::QByteArray:
+    {
+        quint32 size;
+        readVarint(ds, size);
+        // The size comes from the peer, don't allocate more than the packet can hold
+        if (ds.status() != QDataStream::Ok || size > quint64(qMax<qint64>(packetEnd - ds.device()->pos(), 0)))
+            return false;
+        QByteArray bytes(int(size), Qt::Uninitialized);
+        if (ds.readRawData(bytes.data(), int(size)) != int(size))
+            return false;
+        if (wireType == QMetaType::QString)
+            value = QVariant(QString::fromUtf8(bytes));
+        else
+            value = QVariant(bytes);
+        break;
+    }
+    default:
+        return false;
+    }
+    return ds.status() == QDataStream::Ok;
+}
+
 void serializePropertyChangePacket(QRemoteObjectSourceBase *source, int signalIndex)
 {
     int internalIndex = source->m_api->propertyRawIndexFromSignal(signalIndex);
     auto &ds = source->d->m_packet;
-    ds.setId(PropertyChangePacket);
-    ds << source->name();
+    // As long as no dynamic replica is attached, all replicas were generated from the same .rep
+    // (the signatures match), so they know the type of each property. Without a signature the
+    // node can't check that, so the value keeps its envelope.
+    if (!source->d->isDynamic && !source->m_api->objectSignature().isEmpty()) {
+        const int propertyIndex = source->m_api->sourcePropertyIndex(internalIndex);
+        const auto target = source->m_api->isAdapterProperty(internalIndex) ? source->m_adapter : source->m_object;
+        const auto property = target->metaObject()->property(propertyIndex);
+        const int wireType = compactWireType(property.userType());
+        if (wireType != QMetaType::UnknownType) {
+            setIdAndObject(ds, CompactPropertyChangePacket, source->name(), source->objectId());
+            writeVarint(ds, quint32(internalIndex));
+            writeCompactValue(ds, property.read(target), wireType);
+            ds.finishPacket();
+            return;
+        }
+    }
+    setIdAndObject(ds, PropertyChangePacket, source->name(), source->objectId());
     ds << internalIndex;
     serializeProperty(ds, source, internalIndex);
     ds.finishPacket();
@@ -638,6 +962,14 @@ void deserializePropertyChangePacket(QDataStream& in, int &index, QVariant &valu
     in >> value;
 }
 
+// The value has to be read with readCompactValue(), once the type of the property is known
+void deserializeCompactPropertyChangePacket(QDataStream& in, int &index)
+{
+    quint32 internalIndex;
+    readVarint(in, internalIndex);
+    index = int(internalIndex);
+}
+
 void serializeObjectListPacket(DataStreamPacket &ds, const ObjectInfoList &objects)
 {
     ds.setId(ObjectList);
@@ -650,17 +982,15 @@ void deserializeObjectListPacket(QDataStream &in, ObjectInfoList &objects)
     in >> objects;
 }
 
-void serializePingPacket(DataStreamPacket &ds, const QString &name)
+void serializePingPacket(DataStreamPacket &ds, const QString &name, quint32 objectId)
 {
-    ds.setId(Ping);
-    ds << name;
+    setIdAndObject(ds, Ping, name, objectId);
     ds.finishPacket();
 }
 
-void serializePongPacket(DataStreamPacket &ds, const QString &name)
+void serializePongPacket(DataStreamPacket &ds, const QString &name, quint32 objectId)
 {
-    ds.setId(Pong);
-    ds << name;
+    setIdAndObject(ds, Pong, name, objectId);
     ds.finishPacket();
 }
 
@@ -173,7 +173,8 @@ QVariant &decodeVariant(QVariant &value, int type);
 
 void serializeProperty(QDataStream &, const QRemoteObjectSourceBase *source, int internalIndex);
 
-void serializeHandshakePacket(DataStreamPacket &);
+void serializeHandshakePacket(DataStreamPacket &, quint32 capabilities = 0);
+void deserializeHandshakePacket(QDataStream &, quint32 &capabilities);
 void serializeInitPacket(DataStreamPacket &, const QRemoteObjectRootSource*);
 void serializeProperties(DataStreamPacket &, const QRemoteObjectSourceBase*);
 void deserializeInitPacket(QDataStream &, QVariantList&);
@@ -181,25 +182,44 @@ void deserializeInitPacket(QDataStream &, QVariantList&);
 void serializeInitDynamicPacket(DataStreamPacket &, const QRemoteObjectRootSource*);
 void serializeDefinition(QDataStream &, const QRemoteObjectSourceBase*);
 
-void serializeAddObjectPacket(DataStreamPacket &, const QString &name, bool isDynamic);
-void deserializeAddObjectPacket(QDataStream &, bool &isDynamic);
+// Replicas that were initialized before send these for their properties when they reconnect
+quint64 propertyHash(const QVariant &value);
+void serializeInitDeltaPacket(DataStreamPacket &, const QRemoteObjectRootSource*, const QVector<quint64> &propertyHashes);
+bool deserializeInitDeltaPacket(QDataStream &, QVariantList &values);
+
+void serializeAddObjectPacket(DataStreamPacket &, const QString &name, bool isDynamic, const QVector<quint64> *propertyHashes = nullptr);
+void deserializeAddObjectPacket(QDataStream &, bool &isDynamic, QVector<quint64> &propertyHashes);
 
 void serializeRemoveObjectPacket(DataStreamPacket&, const QString &name);
 //There is no deserializeRemoveObjectPacket - no parameters other than id and name
 
-void serializeInvokePacket(DataStreamPacket&, const QString &name, int call, int index, const QVariantList &args, int serialId = -1, int propertyIndex = -1);
+void serializeInvokePacket(DataStreamPacket&, const QString &name, quint32 objectId, int call, int index, const QVariantList &args, int serialId = -1, int propertyIndex = -1);
 void deserializeInvokePacket(QDataStream& in, int &call, int &index, QVariantList &args, int &serialId, int &propertyIndex);
 
-void serializeInvokeReplyPacket(DataStreamPacket&, const QString &name, int ackedSerialId, const QVariant &value);
+void serializeInvokeReplyPacket(DataStreamPacket&, const QString &name, quint32 objectId, int ackedSerialId, const QVariant &value);
 void deserializeInvokeReplyPacket(QDataStream& in, int &ackedSerialId, QVariant &value);
 
-//TODO do we need the object name or could we go with an id in backend code, this could be a costly allocation
+// A batch holds the payloads of InvokePackets for the same object, written with serializeInvokeCall()
+void serializeInvokeCall(QDataStream &, int call, int index, const QVariantList &args, int serialId = -1, int propertyIndex = -1);
+void serializeInvokeBatchPacket(DataStreamPacket&, const QString &name, quint32 objectId, quint32 count, const QByteArray &calls);
+void deserializeInvokeBatchPacket(QDataStream& in, quint32 &count);
+
+void serializeInvokeBatchReplyPacket(DataStreamPacket&, const QString &name, quint32 objectId, const QVector<QPair<int, QVariant>> &replies);
+void deserializeInvokeBatchReplyPacket(QDataStream& in, QVector<QPair<int, QVariant>> &replies);
+
 void serializePropertyChangePacket(QRemoteObjectSourceBase *source, int signalIndex);
 void deserializePropertyChangePacket(QDataStream& in, int &index, QVariant &value);
+void deserializeCompactPropertyChangePacket(QDataStream& in, int &index);
+
+// Raw encoding of values whose type both sides know, without the QVariant envelope
+Q_AUTOTEST_EXPORT int compactWireType(int userType);
+Q_AUTOTEST_EXPORT void writeCompactValue(QDataStream &ds, const QVariant &value, int wireType);
+// packetEnd is the position in ds.device() where the packet holding the value ends
+Q_AUTOTEST_EXPORT bool readCompactValue(QDataStream &ds, QVariant &value, int wireType, qint64 packetEnd);
 
 // Heartbeat packets
-void serializePingPacket(DataStreamPacket &ds, const QString &name);
-void serializePongPacket(DataStreamPacket &ds, const QString &name);
+void serializePingPacket(DataStreamPacket &ds, const QString &name, quint32 objectId);
+void serializePongPacket(DataStreamPacket &ds, const QString &name, quint32 objectId);
 
 
 } // namespace QRemoteObjectPackets
@@ -58,6 +58,39 @@ QRemoteObjectPendingCallData::QRemoteObjectPendingCallData(int serialId, QRemote
 
 QRemoteObjectPendingCallData::~QRemoteObjectPendingCallData()
 {
+    if (finishedHandler)
+        finishedHandler(QRemoteObjectPendingCall::InvalidMessage, QVariant());
+}
+
+// Stores the result and notifies watchers and the finished handler. The handler
+// runs without the mutex held, as it may query the call.
+void QRemoteObjectPendingCallData::finish(QRemoteObjectPendingCall::Error result, const QVariant &value)
+{
+    QRemoteObjectPendingCall::FinishedHandler handler;
+    {
+        QMutexLocker locker(&mutex);
+        error = result;
+        returnValue = value;
+        done = true;
+        if (watcherHelper)
+            watcherHelper->emitSignals();
+        handler = qExchange(finishedHandler, nullptr);
+    }
+    if (handler)
+        handler(result, value);
+}
+
+// The call won't get a reply, only the finished handler is told
+void QRemoteObjectPendingCallData::abandon()
+{
+    QRemoteObjectPendingCall::FinishedHandler handler;
+    {
+        QMutexLocker locker(&mutex);
+        done = true;
+        handler = qExchange(finishedHandler, nullptr);
+    }
+    if (handler)
+        handler(QRemoteObjectPendingCall::InvalidMessage, QVariant());
 }
 
 void QRemoteObjectPendingCallWatcherHelper::add(QRemoteObjectPendingCallWatcher *watcher)
@@ -127,6 +160,9 @@ QVariant QRemoteObjectPendingCall::returnValue() const
            No error occurred.
     \value InvalidMessage
            The default error state prior to the remote call finishing.
+    \value Timeout
+           No reply arrived within the \l {QRemoteObjectNode::callTimeout()}
+           {call timeout} of the node. This value was introduced in Qt 6.0.
 */
 
 /*!
@@ -158,7 +194,14 @@ bool QRemoteObjectPendingCall::isFinished() const
 /*!
     Blocks for up to \a timeout milliseconds, until the remote call has finished.
 
-    Returns \c true on success, \c false otherwise.
+    If the replica's connection is a TCP or local socket on the calling thread,
+    this blocks on that socket instead of running an event loop. Only packets of
+    that connection are processed while waiting, other events are delivered
+    afterwards. Threads that host sources themselves keep using an event loop.
+
+    Returns \c true if the call finished with a reply, \c false if it is still
+    waiting for one or finished with an error, like
+    QRemoteObjectPendingCall::Timeout.
 */
 bool QRemoteObjectPendingCall::waitForFinished(int timeout)
 {
@@ -166,7 +209,7 @@ bool QRemoteObjectPendingCall::waitForFinished(int timeout)
         return false;
 
     if (d->error != QRemoteObjectPendingCall::InvalidMessage)
-        return true; // already finished
+        return d->error == QRemoteObjectPendingCall::NoError; // already finished
 
     QMutexLocker locker(&d->mutex);
     if (!d->replica)
@@ -175,6 +218,40 @@ bool QRemoteObjectPendingCall::waitForFinished(int timeout)
     return d->replica->waitForFinished(*this, timeout);
 }
 
+/*!
+    \internal
+
+    Has \a handler called once with the error and return value when the call
+    finishes, or with InvalidMessage when it can't finish anymore. It is called
+    right away if that already happened, otherwise on the thread of the replica.
+    Unlike QRemoteObjectPendingCallWatcher, this needs no QObject per call.
+*/
+void QRemoteObjectPendingCall::setFinishedHandler(FinishedHandler handler) const
+{
+    if (!d) {
+        handler(InvalidMessage, QVariant());
+        return;
+    }
+
+    QMutexLocker locker(&d->mutex);
+    if (d->error == InvalidMessage && !d->done && d->replica) {
+        if (d->finishedHandler) {
+            d->finishedHandler = [previous = std::move(d->finishedHandler), handler = std::move(handler)]
+                    (Error error, const QVariant &value) {
+                previous(error, value);
+                handler(error, value);
+            };
+        } else {
+            d->finishedHandler = std::move(handler);
+        }
+        return;
+    }
+    const Error error = d->error;
+    const QVariant value = d->returnValue;
+    locker.unlock();
+    handler(error, value);
+}
+
 QRemoteObjectPendingCall QRemoteObjectPendingCall::fromCompletedCall(const QVariant &returnValue)
 {
     QRemoteObjectPendingCallData *data = new QRemoteObjectPendingCallData;
@@ -266,6 +343,20 @@ void QRemoteObjectPendingCallWatcher::waitForFinished()
     Returns a strongly typed version of the return value of the remote call.
 */
 
+/*! \fn template <typename T> QFuture<T> QRemoteObjectPendingReply<T>::future() const
+    \since 6.0
+
+    Returns a QFuture that gets the return value when the remote call finishes,
+    so continuations can be attached with QFuture::then(). The future is
+    canceled if the call can't finish, for example because the replica was
+    deleted. Continuations run on the thread of the replica.
+
+    No QObject is created for this, unlike with a QRemoteObjectPendingCallWatcher.
+    Use the \c{--future} option of \l {Qt Remote Objects Compiler} {repc} to have
+    replicas provide a method returning the future for each slot with a return
+    value.
+*/
+
 QT_END_NAMESPACE
 
 #include "moc_qremoteobjectpendingcall.cpp"
@@ -43,6 +43,11 @@
 #include <QtRemoteObjects/qtremoteobjectglobal.h>
 
 #include <QtCore/qvariant.h>
+#if QT_CONFIG(future)
+#include <QtCore/qfuture.h>
+#endif
+
+#include <functional>
 
 QT_BEGIN_NAMESPACE
 
@@ -54,7 +59,8 @@ class Q_REMOTEOBJECTS_EXPORT QRemoteObjectPendingCall
 public:
     enum Error {
         NoError,
-        InvalidMessage
+        InvalidMessage,
+        Timeout
     };
 
     QRemoteObjectPendingCall();
@@ -75,11 +81,15 @@ public:
 protected:
     QRemoteObjectPendingCall(QRemoteObjectPendingCallData *dd);
 
+    typedef std::function<void(Error, const QVariant &)> FinishedHandler;
+    void setFinishedHandler(FinishedHandler handler) const;
+
     /// Shared data, note: might be null
     QExplicitlySharedDataPointer<QRemoteObjectPendingCallData> d;
 
 private:
     friend class QConnectedReplicaImplementation;
+    friend class QRemoteObjectPendingCallData;
 };
 
 QT_END_NAMESPACE
@@ -128,6 +138,22 @@ public:
         return qvariant_cast<Type>(QRemoteObjectPendingCall::returnValue());
     }
 
+#if QT_CONFIG(future)
+    QFuture<Type> future() const
+    {
+        // The future's state is allocated by QtCore and shared with its continuations, and the
+        // handler has to keep a reference to it, so neither can come from a pool of ours
+        QFutureInterface<Type> promise(QFutureInterfaceBase::Started);
+        setFinishedHandler([promise](Error error, const QVariant &value) mutable {
+            if (error == NoError)
+                promise.reportResult(qvariant_cast<Type>(value));
+            else
+                promise.reportCanceled();
+            promise.reportFinished();
+        });
+        return promise.future();
+    }
+#endif
 };
 
 // NOTE: manual expansion of Q_DECLARE_METATYPE_TEMPLATE_1ARG, minus the IsSequentialContainer
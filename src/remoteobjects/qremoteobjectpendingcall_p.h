@@ -77,6 +77,12 @@ public:
     mutable QMutex mutex;
 
     mutable QScopedPointer<QRemoteObjectPendingCallWatcherHelper> watcherHelper;
+    // Set by QRemoteObjectPendingReply::future(), run once instead of a watcher's signal
+    QRemoteObjectPendingCall::FinishedHandler finishedHandler;
+    bool done = false;
+
+    void finish(QRemoteObjectPendingCall::Error result, const QVariant &value);
+    void abandon();
 };
 
 class QRemoteObjectPendingCallWatcherHelper: public QObject
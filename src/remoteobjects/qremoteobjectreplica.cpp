@@ -46,10 +46,13 @@
 #include "qremoteobjectpendingcall_p.h"
 #include "qconnectionfactories_p.h"
 #include "qremoteobjectsource_p.h"
+#include "qremoteobjectsourceio_p.h"
 
 #include <QtCore/qcoreapplication.h>
 #include <QtCore/qdatastream.h>
+#include <QtCore/qdeadlinetimer.h>
 #include <QtCore/qelapsedtimer.h>
+#include <QtCore/qmath.h>
 #include <QtCore/qvariant.h>
 #include <QtCore/qthread.h>
 
@@ -90,41 +93,135 @@ QRemoteObjectReplicaImplementation::~QRemoteObjectReplicaImplementation()
 {
 }
 
+PendingCallSlab::PendingCallSlab()
+    : m_wheel(wheelSize)
+{
+}
+
+void PendingCallSlab::setCapacity(int capacity)
+{
+    Q_ASSERT(m_size == 0);
+    m_capacity = int(qNextPowerOfTwo(quint32(qBound(1, capacity, int(maxCapacity)) - 1)));
+    m_entries.clear();
+}
+
+// Returns a serial id whose entry is free, ids are only reused after wrapping around.
+// The slab must not be full.
+int PendingCallSlab::nextSerialId()
+{
+    Q_ASSERT(!isFull());
+    if (m_entries.isEmpty())
+        m_entries.resize(m_capacity);
+    forever {
+        const int serialId = m_nextSerialId;
+        m_nextSerialId = serialId == std::numeric_limits<int>::max() ? 1 : serialId + 1;
+        if (m_entries.at(entryIndex(serialId)).serialId == 0)
+            return serialId;
+    }
+}
+
+// A timeout of 0 lets the call wait for its reply forever
+void PendingCallSlab::insert(int serialId, const QRemoteObjectPendingCallData::Ptr &call, int timeout)
+{
+    Q_ASSERT(serialId > 0);
+    const int index = entryIndex(serialId);
+    Entry &entry = m_entries[index];
+    Q_ASSERT(entry.serialId == 0);
+    entry.serialId = serialId;
+    entry.call = call;
+    entry.hasDeadline = timeout > 0;
+    entry.older = m_newest;
+    entry.newer = -1;
+    if (m_newest >= 0)
+        m_entries[m_newest].newer = index;
+    else
+        m_oldest = index;
+    m_newest = index;
+    ++m_size;
+    if (!entry.hasDeadline)
+        return;
+
+    entry.deadline = QDeadlineTimer(timeout, Qt::CoarseTimer);
+    if (m_scheduled == 0)
+        m_tickInterval = qMax(timeout / (wheelSize / 2), 1);
+    ++m_scheduled;
+    schedule(serialId, entry.deadline);
+}
+
+void PendingCallSlab::schedule(int serialId, const QDeadlineTimer &deadline)
+{
+    // Deadlines beyond a turn of the wheel are rescheduled when their bucket comes up
+    const qint64 ticks = qBound<qint64>(1, (deadline.remainingTime() + m_tickInterval - 1) / m_tickInterval, wheelSize);
+    m_wheel[(m_wheelPos + int(ticks) - 1) % wheelSize].append(serialId);
+}
+
+QRemoteObjectPendingCallData::Ptr PendingCallSlab::take(int serialId)
+{
+    if (serialId <= 0 || m_entries.isEmpty())
+        return QRemoteObjectPendingCallData::Ptr();
+    Entry &entry = m_entries[entryIndex(serialId)];
+    if (entry.serialId != serialId)
+        return QRemoteObjectPendingCallData::Ptr(); // expired, or never sent
+    // An id left in the wheel is skipped, as it doesn't match the entry anymore
+    if (entry.hasDeadline)
+        --m_scheduled;
+    if (entry.older >= 0)
+        m_entries[entry.older].newer = entry.newer;
+    else
+        m_oldest = entry.newer;
+    if (entry.newer >= 0)
+        m_entries[entry.newer].older = entry.older;
+    else
+        m_newest = entry.older;
+    entry.serialId = 0;
+    entry.hasDeadline = false;
+    entry.older = entry.newer = -1;
+    --m_size;
+    return qExchange(entry.call, QRemoteObjectPendingCallData::Ptr());
+}
+
+// In the order the calls were sent
+QVector<QRemoteObjectPendingCallData::Ptr> PendingCallSlab::takeAll()
+{
+    QVector<QRemoteObjectPendingCallData::Ptr> calls;
+    calls.reserve(m_size);
+    while (m_oldest >= 0)
+        calls.append(takeOldest());
+    return calls;
+}
+
+QRemoteObjectPendingCallData::Ptr PendingCallSlab::takeOldest()
+{
+    if (m_oldest < 0)
+        return QRemoteObjectPendingCallData::Ptr();
+    return take(m_entries.at(m_oldest).serialId);
+}
+
+// Advances the wheel by one tick, returning the calls whose deadline passed
+QVector<QRemoteObjectPendingCallData::Ptr> PendingCallSlab::takeExpired()
+{
+    QVector<QRemoteObjectPendingCallData::Ptr> expired;
+    const QVector<int> bucket = qExchange(m_wheel[m_wheelPos], {});
+    m_wheelPos = (m_wheelPos + 1) % wheelSize;
+    for (const int serialId : bucket) {
+        const Entry &entry = m_entries.at(entryIndex(serialId));
+        if (entry.serialId != serialId || !entry.hasDeadline)
+            continue;
+        if (entry.deadline.hasExpired())
+            expired.append(take(serialId));
+        else
+            schedule(serialId, entry.deadline);
+    }
+    return expired;
+}
+
 QConnectedReplicaImplementation::QConnectedReplicaImplementation(const QString &name, const QMetaObject *meta, QRemoteObjectNode *node)
     : QRemoteObjectReplicaImplementation(name, meta, node), connectionToSource(nullptr)
 {
-    m_heartbeatTimer.setTimerType(Qt::CoarseTimer);
-    m_heartbeatTimer.setSingleShot(true);
-    m_heartbeatTimer.setInterval(node->heartbeatInterval());
-
-    connect(node, &QRemoteObjectNode::heartbeatIntervalChanged, this, [this](int interval) {
-        m_heartbeatTimer.stop();
-        m_heartbeatTimer.setInterval(interval);
-        if (interval)
-            m_heartbeatTimer.start();
-    });
-    connect(&m_heartbeatTimer, &QTimer::timeout, this, [this] {
-        // TODO: Revisit if a baseclass method can be used to avoid specialized cast
-        // conditional logic.
-        auto clientIo = qobject_cast<ClientIoDevice *>(connectionToSource);
-        if (m_pendingCalls.contains(0)) {
-            m_pendingCalls.take(0);
-            // The source didn't respond in time, disconnect the connection
-            if (clientIo)
-                clientIo->disconnectFromServer();
-            else if (connectionToSource)
-                connectionToSource->close();
-        } else {
-            serializePingPacket(m_packet, m_objectName);
-            if (sendCommandWithReply(0).d->serialId == -1) {
-                m_heartbeatTimer.stop();
-                if (clientIo)
-                    clientIo->disconnectFromServer();
-                else if (connectionToSource)
-                    connectionToSource->close();
-            }
-        }
-    });
+    if (node)
+        m_pendingCalls.setCapacity(node->maxPendingCalls());
+    m_callTimeoutTimer.setTimerType(Qt::CoarseTimer);
+    connect(&m_callTimeoutTimer, &QTimer::timeout, this, &QConnectedReplicaImplementation::expireCalls);
 
     if (!meta)
         return;
@@ -144,11 +241,17 @@ QConnectedReplicaImplementation::~QConnectedReplicaImplementation()
         qCDebug(QT_REMOTEOBJECT) << "Replica deleted: sending RemoveObject to RemoteObjectSource" << m_objectName;
         serializeRemoveObjectPacket(m_packet, m_objectName);
         sendCommand();
+        connectionToSource->releaseObjectId(m_objectName);
     }
     for (auto prop : m_propertyStorage) {
         if (prop.canConvert<QObject*>())
             prop.value<QObject *>()->deleteLater();
     }
+    delete m_snapshot.loadAcquire();
+    qDeleteAll(m_retiredSnapshots[0]);
+    qDeleteAll(m_retiredSnapshots[1]);
+    for (const QRemoteObjectPendingCallData::Ptr &call : m_pendingCalls.takeAll())
+        call->abandon();
 }
 
 bool QRemoteObjectReplicaImplementation::needsDynamicInitialization() const
@@ -194,8 +297,6 @@ bool QConnectedReplicaImplementation::sendCommand()
     }
 
     connectionToSource->write(m_packet.array, m_packet.size);
-    if (m_heartbeatTimer.interval())
-        m_heartbeatTimer.start();
     return true;
 }
 
@@ -220,6 +321,7 @@ void QConnectedReplicaImplementation::initialize(QVariantList &values)
         }
         qCDebug(QT_REMOTEOBJECT) << "SETPROPERTY" << i << m_metaObject->property(i+offset).name() << values.at(i).typeName() << values.at(i).toString();
     }
+    publishSnapshot();
 
     Q_ASSERT(m_state.loadAcquire() < QRemoteObjectReplica::Valid || m_state.loadAcquire() == QRemoteObjectReplica::Suspect);
     setState(QRemoteObjectReplica::Valid);
@@ -238,8 +340,6 @@ void QConnectedReplicaImplementation::initialize(QVariantList &values)
     emitNotified();
 
     qCDebug(QT_REMOTEOBJECT) << "isSet = true for" << m_objectName;
-    if (node()->heartbeatInterval())
-        m_heartbeatTimer.start();
 }
 
 void QRemoteObjectReplicaImplementation::emitInitialized()
@@ -337,6 +437,16 @@ bool QConnectedReplicaImplementation::waitForSource(int timeout)
         break;
     }
 
+    // Once connected, wait for the Init packet by reading only from that connection
+    const QPointer<IoDeviceBase> connection = connectionToSource;
+    if (connection && connection->canWaitForReadyRead() && !QRemoteObjectSourceIo::existsOnCurrentThread()) {
+        const QPointer<QObject> self = this;
+        const QRemoteObjectReplica::State initialState = state();
+        const QDeadlineTimer deadline(timeout);
+        while (connection && self && state() == initialState && connection->waitForReadyRead(deadline)) {}
+        return self && state() == QRemoteObjectReplica::State::Valid;
+    }
+
     const static int stateChangedIndex = QRemoteObjectReplica::staticMetaObject.indexOfMethod("stateChanged(State,State)");
     Q_ASSERT(stateChangedIndex != -1);
 
@@ -369,16 +479,16 @@ void QConnectedReplicaImplementation::_q_send(QMetaObject::Call call, int index,
         }
         if (index < m_methodOffset) //index - m_methodOffset < 0 is invalid, and can't be resolved on the Source side
             qCWarning(QT_REMOTEOBJECT) << "Skipping invalid method invocation.  Index not found:" << index << "( offset =" << m_methodOffset << ") object:" << m_objectName << this->m_metaObject->method(index).name();
-        else {
-            serializeInvokePacket(m_packet, m_objectName, call, index - m_methodOffset, args);
+        else if (!addToBatch(call, index - m_methodOffset, args)) {
+            serializeInvokePacket(m_packet, m_objectName, m_objectId, call, index - m_methodOffset, args);
             sendCommand();
         }
     } else {
         qCDebug(QT_REMOTEOBJECT) << "Send" << call << this->m_metaObject->property(index).name() << index << args << connectionToSource;
         if (index < m_propertyOffset) //index - m_propertyOffset < 0 is invalid, and can't be resolved on the Source side
             qCWarning(QT_REMOTEOBJECT) << "Skipping invalid property invocation.  Index not found:" << index << "( offset =" << m_propertyOffset << ") object:" << m_objectName << this->m_metaObject->property(index).name();
-        else {
-            serializeInvokePacket(m_packet, m_objectName, call, index - m_propertyOffset, args);
+        else if (!addToBatch(call, index - m_propertyOffset, args)) {
+            serializeInvokePacket(m_packet, m_objectName, m_objectId, call, index - m_propertyOffset, args);
             sendCommand();
         }
     }
@@ -389,8 +499,20 @@ QRemoteObjectPendingCall QConnectedReplicaImplementation::_q_sendWithReply(QMeta
     Q_ASSERT(call == QMetaObject::InvokeMetaMethod);
 
     qCDebug(QT_REMOTEOBJECT) << "Send" << call << this->m_metaObject->method(index).name() << index << args << connectionToSource;
-    int serialId = (m_curSerialId == std::numeric_limits<int>::max() ? 1 : m_curSerialId++);
-    serializeInvokePacket(m_packet, m_objectName, call, index - m_methodOffset, args, serialId);
+    if (m_pendingCalls.isFull()) {
+        // Most likely the replies were lost, treat the oldest call as timed out to make room
+        const QRemoteObjectPendingCallData::Ptr oldest = m_pendingCalls.takeOldest();
+        qCWarning(QT_REMOTEOBJECT) << "Too many calls waiting for a reply from" << m_objectName
+                                   << ", giving up on serial id" << oldest->serialId;
+        ++m_expiredCalls;
+        oldest->finish(QRemoteObjectPendingCall::Timeout, QVariant());
+    }
+    const int serialId = m_pendingCalls.nextSerialId();
+    if (addToBatch(call, index - m_methodOffset, args, serialId)) {
+        m_batchSerialIds.append(serialId);
+        return addPendingCall(serialId);
+    }
+    serializeInvokePacket(m_packet, m_objectName, m_objectId, call, index - m_methodOffset, args, serialId);
     return sendCommandWithReply(serialId);
 }
 
@@ -402,35 +524,96 @@ QRemoteObjectPendingCall QConnectedReplicaImplementation::sendCommandWithReply(i
     }
 
     qCDebug(QT_REMOTEOBJECT) << "Sent InvokePacket with serial id:" << serialId;
+    return addPendingCall(serialId);
+}
+
+QRemoteObjectPendingCall QConnectedReplicaImplementation::addPendingCall(int serialId)
+{
     QRemoteObjectPendingCall pendingCall(new QRemoteObjectPendingCallData(serialId, this));
-    Q_ASSERT(!m_pendingCalls.contains(serialId));
-    m_pendingCalls[serialId] = pendingCall;
+    m_pendingCalls.insert(serialId, pendingCall.d, node()->callTimeout());
+    if (m_pendingCalls.hasTimeouts() && (!m_callTimeoutTimer.isActive()
+                                         || m_callTimeoutTimer.interval() != m_pendingCalls.tickInterval()))
+        m_callTimeoutTimer.start(m_pendingCalls.tickInterval());
     return pendingCall;
 }
 
-void QConnectedReplicaImplementation::notifyAboutReply(int ackedSerialId, const QVariant &value)
+void QConnectedReplicaImplementation::expireCalls()
 {
-    QRemoteObjectPendingCall call = m_pendingCalls.take(ackedSerialId);
-    if (ackedSerialId == 0) {
-        m_heartbeatTimer.stop();
-        if (m_heartbeatTimer.interval())
-            m_heartbeatTimer.start();
-        return;
+    const auto expired = m_pendingCalls.takeExpired();
+    if (!m_pendingCalls.hasTimeouts())
+        m_callTimeoutTimer.stop();
+    for (const QRemoteObjectPendingCallData::Ptr &call : expired) {
+        qCDebug(QT_REMOTEOBJECT) << "No reply in time for serial id" << call->serialId << "of" << m_objectName;
+        ++m_expiredCalls;
+        call->finish(QRemoteObjectPendingCall::Timeout, QVariant());
     }
+}
+
+// Returns true if the call was added to the open batch, instead of having to be sent on its own
+bool QConnectedReplicaImplementation::addToBatch(QMetaObject::Call call, int index, const QVariantList &args, int serialId)
+{
+    // 1.3 hosts don't know InvokeBatchPacket
+    if (!m_batchDepth || connectionToSource.isNull() || connectionToSource->isLegacyProtocol())
+        return false;
+
+    QDataStream ds(&m_batchCalls, QIODevice::WriteOnly | QIODevice::Append);
+    ds.setVersion(QtRemoteObjects::dataStreamVersion);
+    serializeInvokeCall(ds, call, index, args, serialId);
+    ++m_batchCount;
+    return true;
+}
 
-    QMutexLocker mutex(&call.d->mutex);
+void QConnectedReplicaImplementation::beginBatch()
+{
+    ++m_batchDepth;
+}
+
+bool QConnectedReplicaImplementation::commitBatch()
+{
+    if (m_batchDepth == 0 || --m_batchDepth > 0 || m_batchCount == 0)
+        return true;
 
-    // clear error flag
-    call.d->error = QRemoteObjectPendingCall::NoError;
-    call.d->returnValue = value;
+    serializeInvokeBatchPacket(m_packet, m_objectName, m_objectId, m_batchCount, m_batchCalls);
+    m_batchCalls.clear();
+    m_batchCount = 0;
+    const QVector<int> serialIds = qExchange(m_batchSerialIds, {});
+    if (sendCommand()) {
+        qCDebug(QT_REMOTEOBJECT) << "Sent InvokeBatchPacket with" << serialIds.size() << "calls expecting a reply";
+        return true;
+    }
 
-    // notify watchers if needed
-    if (call.d->watcherHelper)
-        call.d->watcherHelper->emitSignals();
+    // The connection was lost since the calls were made, they won't get a reply
+    for (const int serialId : serialIds) {
+        if (const auto call = m_pendingCalls.take(serialId))
+            call->finish(QRemoteObjectPendingCall::InvalidMessage, QVariant());
+    }
+    return false;
+}
+
+void QConnectedReplicaImplementation::notifyAboutReply(int ackedSerialId, const QVariant &value)
+{
+    // The call may have timed out already
+    const QRemoteObjectPendingCallData::Ptr call = m_pendingCalls.take(ackedSerialId);
+    if (!call)
+        return;
+
+    // clears the error flag and notifies watchers if needed
+    call->finish(QRemoteObjectPendingCall::NoError, value);
 }
 
 bool QConnectedReplicaImplementation::waitForFinished(const QRemoteObjectPendingCall& call, int timeout)
 {
+    // The reply is dispatched in place while blocking on the socket, no event loop is needed
+    const QPointer<IoDeviceBase> connection = connectionToSource;
+    if (connection && connection->canWaitForReadyRead() && !QRemoteObjectSourceIo::existsOnCurrentThread()) {
+        call.d->mutex.unlock();
+        const QDeadlineTimer deadline(timeout);
+        while (connection && call.d->error == QRemoteObjectPendingCall::InvalidMessage
+               && connection->waitForReadyRead(deadline)) {}
+        call.d->mutex.lock();
+        return call.d->error == QRemoteObjectPendingCall::NoError;
+    }
+
     if (!call.d->watcherHelper)
         call.d->watcherHelper.reset(new QRemoteObjectPendingCallWatcherHelper);
 
@@ -445,7 +628,7 @@ bool QConnectedReplicaImplementation::waitForFinished(const QRemoteObjectPending
 
     call.d->mutex.lock();
 
-    return call.d->error != QRemoteObjectPendingCall::InvalidMessage;
+    return call.d->error == QRemoteObjectPendingCall::NoError;
 }
 
 const QVariant QConnectedReplicaImplementation::getProperty(int i) const
@@ -459,11 +642,62 @@ void QConnectedReplicaImplementation::setProperties(const QVariantList &properti
     Q_ASSERT(m_propertyStorage.isEmpty());
     m_propertyStorage.reserve(properties.length());
     m_propertyStorage = properties;
+    publishSnapshot();
 }
 
 void QConnectedReplicaImplementation::setProperty(int i, const QVariant &prop)
 {
     m_propertyStorage[i] = prop;
+    publishSnapshot();
+}
+
+QVariantList QConnectedReplicaImplementation::propertySnapshot() const
+{
+    if (!m_snapshot.loadAcquire()) {
+        // Nothing is published until the first call, and only the replica's thread can do it
+        m_snapshotRequested.storeRelease(1);
+        auto self = const_cast<QConnectedReplicaImplementation *>(this);
+        if (thread() == QThread::currentThread()) {
+            self->publishSnapshot();
+        } else {
+            QMetaObject::invokeMethod(self, [self]() {
+                if (!self->m_snapshot.loadAcquire())
+                    self->publishSnapshot();
+            }, Qt::BlockingQueuedConnection);
+        }
+    }
+
+    // Announce the read before loading the pointer, so publishSnapshot() either sees us and
+    // keeps what we load, or has already replaced it before our load. Both operations need
+    // to be sequentially consistent for that, hence the ordered read-modify-writes.
+    const int epoch = m_snapshotEpoch.loadAcquire();
+    m_snapshotReaders[epoch].fetchAndAddOrdered(1);
+    const QVariantList *snapshot = m_snapshot.fetchAndAddOrdered(0);
+    // Published lists are never modified, copying one only references its data
+    const QVariantList values = snapshot ? *snapshot : QVariantList();
+    m_snapshotReaders[epoch].fetchAndSubRelease(1);
+    return values;
+}
+
+void QConnectedReplicaImplementation::publishSnapshot()
+{
+    if (!m_snapshotRequested.loadAcquire())
+        return;
+
+    const int epoch = m_snapshotEpoch.loadRelaxed();
+    const QVariantList *previous = m_snapshot.fetchAndStoreOrdered(new QVariantList(m_propertyStorage));
+    if (previous)
+        m_retiredSnapshots[epoch].append(previous);
+    // Readers announce themselves in the current epoch, so the other one only drains. Once it
+    // is empty, nobody can still copy a snapshot retired before the current epoch began. New
+    // readers then move to the drained epoch, and the current one starts draining. This way a
+    // steady stream of readers can't keep snapshots from being freed.
+    const int previousEpoch = 1 - epoch;
+    if (m_snapshotReaders[previousEpoch].fetchAndAddOrdered(0) == 0) {
+        qDeleteAll(m_retiredSnapshots[previousEpoch]);
+        m_retiredSnapshots[previousEpoch].clear();
+        m_snapshotEpoch.fetchAndStoreOrdered(previousEpoch);
+    }
 }
 
 void QConnectedReplicaImplementation::setConnection(IoDeviceBase *conn)
@@ -478,6 +712,7 @@ void QConnectedReplicaImplementation::setConnection(IoDeviceBase *conn)
 void QConnectedReplicaImplementation::setDisconnected()
 {
     connectionToSource.clear();
+    m_objectId = 0;
     setState(QRemoteObjectReplica::State::Suspect);
     for (const int index : childIndices()) {
         auto pointerToQObject = qvariant_cast<QObject *>(getProperty(index));
@@ -487,9 +722,20 @@ void QConnectedReplicaImplementation::setDisconnected()
     }
 }
 
-void QConnectedReplicaImplementation::requestRemoteObjectSource()
+void QConnectedReplicaImplementation::requestRemoteObjectSource(bool sendPropertyHashes)
 {
-    serializeAddObjectPacket(m_packet, m_objectName, needsDynamicInitialization());
+    if (connectionToSource.isNull() || connectionToSource->isLegacyProtocol()) {
+        serializeAddObjectPacket(m_packet, m_objectName, needsDynamicInitialization());
+    } else {
+        // After a reconnect, let the source know what we have so it can skip unchanged properties
+        QVector<quint64> propertyHashes;
+        if (sendPropertyHashes && state() == QRemoteObjectReplica::Suspect && !needsDynamicInitialization()) {
+            propertyHashes.reserve(m_propertyStorage.size());
+            for (const QVariant &value : qAsConst(m_propertyStorage))
+                propertyHashes.append(propertyHash(value));
+        }
+        serializeAddObjectPacket(m_packet, m_objectName, needsDynamicInitialization(), &propertyHashes);
+    }
     sendCommand();
 }
 
@@ -758,6 +1004,98 @@ QRemoteObjectReplica::State QRemoteObjectReplica::state() const
     return d_impl->state();
 }
 
+/*!
+    \since 6.0
+
+    Returns a copy of the replica's property values, in the order of the
+    replica's properties.
+
+    Unlike the property getters, this function can be called from any thread.
+    Once it was called, the replica publishes a new read-only copy of its
+    values whenever it applies a change received from the \l {Source}, and
+    this returns the latest one without taking a lock. The values are
+    consistent with each other, as they were between two changes. Replicas
+    that are never asked for a snapshot don't publish copies.
+
+    The first call from a thread other than the replica's waits for the
+    replica's thread to publish the initial copy, so that thread has to run
+    an event loop.
+
+    Replicas acquired from the node hosting the \l {Source}, and replicas
+    without a node, return an empty list.
+
+    Pointers to child replicas in the returned values must only be used from
+    the replica's thread.
+
+    \sa state()
+*/
+QVariantList QRemoteObjectReplica::propertySnapshot() const
+{
+    return d_impl->propertySnapshot();
+}
+
+/*!
+    \since 6.0
+
+    Starts collecting the slot calls and property writes made on this replica,
+    instead of sending each on its own. commitBatch() sends them to the
+    \l {Source} in a single packet, where they are executed in order. The
+    return values of all calls in a batch also come back in a single packet.
+
+    Calls to beginBatch() can be nested. The calls are sent by the
+    commitBatch() matching the outermost beginBatch().
+
+    Calls made while the replica is not connected, or is connected to a host
+    using protocol version 1.3, are sent right away, as without a batch.
+
+    \sa commitBatch()
+*/
+void QRemoteObjectReplica::beginBatch()
+{
+    d_impl->beginBatch();
+}
+
+/*!
+    \since 6.0
+
+    Returns the number of calls made through this replica that are waiting
+    for their reply.
+
+    \sa expiredCallCount()
+*/
+int QRemoteObjectReplica::pendingCallCount() const
+{
+    return d_impl->pendingCallCount();
+}
+
+/*!
+    \since 6.0
+
+    Returns the number of calls made through this replica that got no reply
+    within the \l {QRemoteObjectNode::callTimeout()} {call timeout} of the node,
+    or were given up on because too many calls were waiting for their reply.
+
+    \sa pendingCallCount()
+*/
+quint64 QRemoteObjectReplica::expiredCallCount() const
+{
+    return d_impl->expiredCallCount();
+}
+
+/*!
+    \since 6.0
+
+    Sends the calls collected since beginBatch(). Returns \c false if they
+    could not be sent, in which case the pending replies of the calls will
+    never finish.
+
+    \sa beginBatch()
+*/
+bool QRemoteObjectReplica::commitBatch()
+{
+    return d_impl->commitBatch();
+}
+
 QRemoteObjectNode *QRemoteObjectReplica::node() const
 {
     return d_impl->node();
@@ -796,6 +1134,11 @@ bool QRemoteObjectReplica::isReplicaValid() const
 
     If \a timeout is -1, this function will not time out.
 
+    Once the replica is connected to a TCP or local socket on its own thread,
+    this blocks on that socket instead of running an event loop, and only
+    packets of that connection are processed while waiting. Threads that host
+    sources themselves keep using an event loop.
+
     \sa isInitialized(), initialized()
 */
 bool QRemoteObjectReplica::waitForSource(int timeout)
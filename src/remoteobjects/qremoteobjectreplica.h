@@ -76,6 +76,11 @@ public:
     bool waitForSource(int timeout = 30000);
     bool isInitialized() const;
     State state() const;
+    QVariantList propertySnapshot() const;
+    int pendingCallCount() const;
+    quint64 expiredCallCount() const;
+    void beginBatch();
+    bool commitBatch();
     QRemoteObjectNode *node() const;
     virtual void setNode(QRemoteObjectNode *node);
 
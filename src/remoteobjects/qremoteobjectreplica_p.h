@@ -54,13 +54,16 @@
 #include "qremoteobjectreplica.h"
 
 #include "qremoteobjectpendingcall.h"
+#include "qremoteobjectpendingcall_p.h"
 
 #include "qremoteobjectpacket_p.h"
 
+#include <QtCore/qatomic.h>
 #include <QtCore/qpointer.h>
 #include <QtCore/qvector.h>
 #include <QtCore/qdatastream.h>
 #include <QtCore/qcompilerdetection.h>
+#include <QtCore/qdeadlinetimer.h>
 #include <QtCore/qtimer.h>
 
 QT_BEGIN_NAMESPACE
@@ -76,6 +79,7 @@ public:
     virtual const QVariant getProperty(int i) const = 0;
     virtual void setProperties(const QVariantList &) = 0;
     virtual void setProperty(int i, const QVariant &) = 0;
+    virtual QVariantList propertySnapshot() const = 0;
     virtual bool isInitialized() const = 0;
     virtual QRemoteObjectReplica::State state() const = 0;
     virtual bool waitForSource(int) = 0;
@@ -83,6 +87,10 @@ public:
 
     virtual void _q_send(QMetaObject::Call call, int index, const QVariantList &args) = 0;
     virtual QRemoteObjectPendingCall _q_sendWithReply(QMetaObject::Call call, int index, const QVariantList &args) = 0;
+    virtual void beginBatch() = 0;
+    virtual bool commitBatch() = 0;
+    virtual int pendingCallCount() const = 0;
+    virtual quint64 expiredCallCount() const = 0;
 };
 
 class QStubReplicaImplementation final : public QReplicaImplementationInterface
@@ -94,6 +102,7 @@ public:
     const QVariant getProperty(int i) const override;
     void setProperties(const QVariantList &) override;
     void setProperty(int i, const QVariant &) override;
+    QVariantList propertySnapshot() const override { return QVariantList(); }
     bool isInitialized() const override { return false; }
     QRemoteObjectReplica::State state() const override { return QRemoteObjectReplica::State::Uninitialized;}
     bool waitForSource(int) override { return false; }
@@ -101,6 +110,10 @@ public:
 
     void _q_send(QMetaObject::Call call, int index, const QVariantList &args) override;
     QRemoteObjectPendingCall _q_sendWithReply(QMetaObject::Call call, int index, const QVariantList &args) override;
+    void beginBatch() override {}
+    bool commitBatch() override { return false; }
+    int pendingCallCount() const override { return 0; }
+    quint64 expiredCallCount() const override { return 0; }
     QVariantList m_propertyStorage;
 };
 
@@ -115,12 +128,15 @@ public:
     const QVariant getProperty(int i) const override = 0;
     void setProperties(const QVariantList &) override = 0;
     void setProperty(int i, const QVariant &) override = 0;
+    QVariantList propertySnapshot() const override = 0;
     virtual bool isShortCircuit() const = 0;
     bool isInitialized() const override { return true; }
     QRemoteObjectReplica::State state() const override { return QRemoteObjectReplica::State(m_state.loadRelaxed()); }
     void setState(QRemoteObjectReplica::State state);
     bool waitForSource(int) override { return true; }
     virtual bool waitForFinished(const QRemoteObjectPendingCall &, int) { return true; }
+    int pendingCallCount() const override { return 0; }
+    quint64 expiredCallCount() const override { return 0; }
     virtual void notifyAboutReply(int, const QVariant &) {}
     virtual void configurePrivate(QRemoteObjectReplica *);
     void emitInitialized();
@@ -147,6 +163,63 @@ public:
     QAtomicInt m_state;
 };
 
+// The calls of a replica waiting for a reply. A call is stored at its serial id
+// modulo the capacity, and serial ids are handed out so that they land on a free
+// entry. The capacity is fixed, the entries are allocated with the first call.
+// Calls are linked in the order they were sent, so takeOldest() makes room in
+// constant time. Calls with a timeout are also kept in a timer wheel, advanced by
+// takeExpired().
+class PendingCallSlab
+{
+public:
+    PendingCallSlab();
+
+    static const int defaultCapacity = 1024;
+    static const int maxCapacity = 1 << 20;
+    // Rounded up to a power of two, can only be changed while no call is waiting
+    void setCapacity(int capacity);
+    int capacity() const { return m_capacity; }
+
+    int nextSerialId();
+    void insert(int serialId, const QRemoteObjectPendingCallData::Ptr &call, int timeout);
+    QRemoteObjectPendingCallData::Ptr take(int serialId);
+    QVector<QRemoteObjectPendingCallData::Ptr> takeAll();
+    QRemoteObjectPendingCallData::Ptr takeOldest();
+    int size() const { return m_size; }
+    bool isFull() const { return m_size == m_capacity; }
+
+    // Interval in ms at which takeExpired() has to be called while hasTimeouts()
+    int tickInterval() const { return m_tickInterval; }
+    bool hasTimeouts() const { return m_scheduled > 0; }
+    QVector<QRemoteObjectPendingCallData::Ptr> takeExpired();
+
+private:
+    struct Entry
+    {
+        int serialId = 0; // 0 for a free entry, it is never assigned
+        bool hasDeadline = false;
+        QDeadlineTimer deadline;
+        QRemoteObjectPendingCallData::Ptr call;
+        int older = -1; // entries of the calls sent just before and after, -1 if none
+        int newer = -1;
+    };
+
+    int entryIndex(int serialId) const { return serialId & (m_capacity - 1); }
+    void schedule(int serialId, const QDeadlineTimer &deadline);
+
+    static const int wheelSize = 32;
+    QVector<Entry> m_entries;
+    int m_capacity = defaultCapacity;
+    int m_size = 0;
+    int m_oldest = -1;
+    int m_newest = -1;
+    int m_nextSerialId = 1;
+    QVector<QVector<int>> m_wheel; // serial ids, wheelSize buckets of tickInterval() each
+    int m_wheelPos = 0;
+    int m_tickInterval = 0;
+    int m_scheduled = 0;
+};
+
 class QConnectedReplicaImplementation final : public QRemoteObjectReplicaImplementation
 {
 public:
@@ -155,35 +228,59 @@ public:
     const QVariant getProperty(int i) const override;
     void setProperties(const QVariantList &) override;
     void setProperty(int i, const QVariant &) override;
+    QVariantList propertySnapshot() const override;
+    void publishSnapshot();
     bool isShortCircuit() const final { return false; }
     bool isInitialized() const override;
     bool waitForSource(int timeout) override;
     QVector<int> childIndices() const;
     void initialize(QVariantList &values);
     void configurePrivate(QRemoteObjectReplica *) override;
-    void requestRemoteObjectSource();
+    void requestRemoteObjectSource(bool sendPropertyHashes = true);
     bool sendCommand();
     QRemoteObjectPendingCall sendCommandWithReply(int serialId);
+    QRemoteObjectPendingCall addPendingCall(int serialId);
+    bool addToBatch(QMetaObject::Call call, int index, const QVariantList &args, int serialId = -1);
     bool waitForFinished(const QRemoteObjectPendingCall &call, int timeout) override;
     void notifyAboutReply(int ackedSerialId, const QVariant &value) override;
+    int pendingCallCount() const override { return m_pendingCalls.size(); }
+    quint64 expiredCallCount() const override { return m_expiredCalls; }
+    void expireCalls();
     void setConnection(IoDeviceBase *conn);
     void setDisconnected();
 
     void _q_send(QMetaObject::Call call, int index, const QVariantList &args) override;
     QRemoteObjectPendingCall _q_sendWithReply(QMetaObject::Call call, int index, const QVariantList& args) override;
+    void beginBatch() override;
+    bool commitBatch() override;
 
     void setDynamicMetaObject(const QMetaObject *meta) override;
     void setDynamicProperties(const QVariantList&) override;
     QVector<QRemoteObjectReplica *> m_parentsNeedingConnect;
     QVariantList m_propertyStorage;
+    // Read-only copies of m_propertyStorage for other threads, only published once
+    // propertySnapshot() was called. Replaced snapshots are kept per epoch, until the
+    // readers that may still copy them are done, see publishSnapshot()
+    mutable QAtomicPointer<const QVariantList> m_snapshot;
+    mutable QAtomicInt m_snapshotRequested;
+    QAtomicInt m_snapshotEpoch;
+    mutable QAtomicInt m_snapshotReaders[2]; // per epoch
+    QVector<const QVariantList *> m_retiredSnapshots[2]; // per epoch
     QVector<int> m_childIndices;
     QPointer<IoDeviceBase> connectionToSource;
+    quint32 m_objectId = 0; // announced by the source's Init packet, 0 to send our name
 
     // pending call data
-    int m_curSerialId = 1; // 0 is reserved for heartbeat signals
-    QHash<int, QRemoteObjectPendingCall> m_pendingCalls;
+    PendingCallSlab m_pendingCalls;
+    QTimer m_callTimeoutTimer;
+    quint64 m_expiredCalls = 0;
     QRemoteObjectPackets::DataStreamPacket m_packet;
-    QTimer m_heartbeatTimer;
+
+    // calls made between beginBatch() and commitBatch(), sent as one InvokeBatchPacket
+    int m_batchDepth = 0;
+    quint32 m_batchCount = 0;
+    QByteArray m_batchCalls;
+    QVector<int> m_batchSerialIds;
 };
 
 class QInProcessReplicaImplementation final : public QRemoteObjectReplicaImplementation
@@ -195,10 +292,14 @@ public:
     const QVariant getProperty(int i) const override;
     void setProperties(const QVariantList &) override;
     void setProperty(int i, const QVariant &) override;
+    QVariantList propertySnapshot() const override { return QVariantList(); }
     bool isShortCircuit() const final { return true; }
 
     void _q_send(QMetaObject::Call call, int index, const QVariantList &args) override;
     QRemoteObjectPendingCall _q_sendWithReply(QMetaObject::Call call, int index, const QVariantList& args) override;
+    // Calls are made directly on the source, there is nothing to combine
+    void beginBatch() override {}
+    bool commitBatch() override { return true; }
 
     QPointer<QRemoteObjectSourceBase> connectionToSource;
 };
@@ -184,6 +184,7 @@ void QRemoteObjectSourceBase::setConnections()
 
 void QRemoteObjectSourceBase::resetObject(QObject *newObject)
 {
+    d->clearInitPackets();
     if (m_object)
         m_object->disconnect(this);
     if (m_adapter) {
@@ -352,10 +353,13 @@ bool QRemoteObjectSourceBase::invoke(QMetaObject::Call c, int index, const QVari
 
 void QRemoteObjectSourceBase::handleMetaCall(int index, QMetaObject::Call call, void **a)
 {
+    int propertyIndex = m_api->propertyIndexFromSignal(index);
+    if (propertyIndex >= 0)
+        d->clearInitPackets();
+
     if (d->m_listeners.empty())
         return;
 
-    int propertyIndex = m_api->propertyIndexFromSignal(index);
     if (propertyIndex >= 0) {
         const int internalIndex = m_api->propertyRawIndexFromSignal(index);
         const auto target = m_api->isAdapterProperty(internalIndex) ? m_adapter : m_object;
@@ -372,35 +376,116 @@ void QRemoteObjectSourceBase::handleMetaCall(int index, QMetaObject::Call call,
                              << (call == 0 ? QLatin1String("InvokeMetaMethod") : QStringLiteral("Non-invoked call: %d").arg(call))
                              << m_api->signalSignature(index) << *marshalArgs(index, a);
 
-    serializeInvokePacket(d->m_packet, name(), call, index, *marshalArgs(index, a), -1, propertyIndex);
+    serializeInvokePacket(d->m_packet, name(), objectId(), call, index, *marshalArgs(index, a), -1, propertyIndex);
     d->m_packet.baseAddress = 0;
 
-    for (IoDeviceBase *io : qAsConst(d->m_listeners))
-        io->write(d->m_packet.array, d->m_packet.size);
+    const bool isPropertyChange = propertyIndex >= 0;
+    for (IoDeviceBase *io : qAsConst(d->m_listeners)) {
+        // Models are never skipped, their adapters can't recover from missed signals
+        if (io->isSuspended() && !hasAdapter()) {
+            if (isPropertyChange)
+                m_staleProperties[io].insert(index);
+            continue;
+        }
+        if (isPropertyChange && (d->conflatePropertyChanges || io->conflatesPropertyChanges()))
+            io->writeConflated(d->m_packet.array, d->m_packet.size, name(), propertyIndex);
+        else
+            io->write(d->m_packet.array, d->m_packet.size, name());
+    }
 }
 
-void QRemoteObjectRootSource::addListener(IoDeviceBase *io, bool dynamic)
+// Sends the current value of the properties that changed while io was suspended, each
+// followed by its notify signal, as handleMetaCall() would have
+void QRemoteObjectSourceBase::resendStaleProperties(IoDeviceBase *io)
 {
-    d->m_listeners.append(io);
+    const QSet<int> signalIndices = m_staleProperties.take(io);
+    for (int index : signalIndices) {
+        serializePropertyChangePacket(this, index);
+        d->m_packet.baseAddress = d->m_packet.size;
+        serializeInvokePacket(d->m_packet, name(), objectId(), QMetaObject::InvokeMetaMethod, index,
+                              QVariantList(), -1, m_api->propertyRawIndexFromSignal(index));
+        d->m_packet.baseAddress = 0;
+        io->write(d->m_packet.array, d->m_packet.size, name());
+    }
+    for (const auto &child : qAsConst(m_children)) {
+        if (child)
+            child->resendStaleProperties(io);
+    }
+}
+
+void QRemoteObjectSourceBase::forgetListener(IoDeviceBase *io)
+{
+    m_staleProperties.remove(io);
+    for (const auto &child : qAsConst(m_children)) {
+        if (child)
+            child->forgetListener(io);
+    }
+}
+
+// The encoded Init packet can only be reused if every property change is announced
+static bool canCacheInitPacket(const QRemoteObjectSourceBase *source)
+{
+    for (int i = 0; i < source->m_api->propertyCount(); ++i) {
+        const QObject *target = source->m_api->isAdapterProperty(i) ? source->m_adapter : source->m_object;
+        if (!target)
+            continue;
+        const QMetaProperty mp = target->metaObject()->property(source->m_api->sourcePropertyIndex(i));
+        if (!mp.hasNotifySignal() && !mp.isConstant())
+            return false;
+    }
+    for (const auto &child : source->m_children) {
+        if (child && !canCacheInitPacket(child))
+            return false;
+    }
+    return true;
+}
+
+void QRemoteObjectRootSource::addListener(IoDeviceBase *io, bool dynamic, const QVector<quint64> &propertyHashes)
+{
+    // A replica that rejected an InitDelta asks again on the same connection
+    if (!d->m_listeners.contains(io))
+        d->m_listeners.append(io);
+    // Gadget definitions are only part of the packets once a dynamic listener showed up
+    if (dynamic && !d->isDynamic)
+        d->clearInitPackets();
     d->isDynamic = d->isDynamic || dynamic;
+    // The Init packet announces our id, so later packets from either side can use it
+    io->bindObjectId(m_objectId, m_name);
 
-    if (dynamic) {
-        d->sentTypes.clear();
-        serializeInitDynamicPacket(d->m_packet, this);
-        io->write(d->m_packet.array, d->m_packet.size);
-    } else {
-        serializeInitPacket(d->m_packet, this);
+    // A reconnecting replica only needs the properties that changed meanwhile
+    if (!dynamic && !propertyHashes.isEmpty() && propertyHashes.size() == m_api->propertyCount()) {
+        serializeInitDeltaPacket(d->m_packet, this, propertyHashes);
         io->write(d->m_packet.array, d->m_packet.size);
+        return;
+    }
+
+    QByteArray &initPacket = dynamic ? d->initDynamicPacket : d->initPacket;
+    if (initPacket.isEmpty()) {
+        if (dynamic) {
+            d->sentTypes.clear();
+            serializeInitDynamicPacket(d->m_packet, this);
+        } else {
+            serializeInitPacket(d->m_packet, this);
+        }
+        if (canCacheInitPacket(this)) {
+            initPacket = d->m_packet.array.left(d->m_packet.size);
+        } else {
+            io->write(d->m_packet.array, d->m_packet.size);
+            return;
+        }
     }
+    io->write(initPacket);
 }
 
 int QRemoteObjectRootSource::removeListener(IoDeviceBase *io, bool shouldSendRemove)
 {
     d->m_listeners.removeAll(io);
+    forgetListener(io);
     if (shouldSendRemove)
     {
         serializeRemoveObjectPacket(d->m_packet, m_api->name());
         io->write(d->m_packet.array, d->m_packet.size);
+        io->releaseObjectId(m_name);
     }
     return d->m_listeners.length();
 }
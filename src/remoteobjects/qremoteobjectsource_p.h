@@ -76,13 +76,18 @@ public:
     QVariantList m_marshalledArgs;
     bool hasAdapter() const { return m_adapter; }
     virtual QString name() const = 0;
+    virtual quint32 objectId() const = 0;
     virtual bool isRoot() const = 0;
 
     QVariantList* marshalArgs(int index, void **a);
     void handleMetaCall(int index, QMetaObject::Call call, void **a);
+    void resendStaleProperties(IoDeviceBase *io);
+    void forgetListener(IoDeviceBase *io);
     bool invoke(QMetaObject::Call c, int index, const QVariantList& args, QVariant* returnValue = nullptr);
     QByteArray m_objectChecksum;
     QMap<int, QPointer<QRemoteObjectSourceBase>> m_children;
+    // Notify signals of the properties that changed while a listener was suspended
+    QHash<IoDeviceBase*, QSet<int>> m_staleProperties;
     struct Private {
         Private(QRemoteObjectSourceIo *io, QRemoteObjectRootSource *root) : m_sourceIo(io), isDynamic(false), root(root) {}
         QRemoteObjectSourceIo *m_sourceIo;
@@ -93,6 +98,13 @@ public:
         QSet<QString> sentTypes;
         bool isDynamic;
         QRemoteObjectRootSource *root;
+        // Replace property changes that are still queued for a listener, see QRemoteObjectHostBase::setPropertyConflationEnabled()
+        bool conflatePropertyChanges = false;
+
+        // Encoded Init/InitDynamic packets, written to every new listener until a property changes
+        QByteArray initPacket;
+        QByteArray initDynamicPacket;
+        void clearInitPackets() { initPacket.clear(); initDynamicPacket.clear(); }
     };
     Private *d;
     static const int qobjectPropertyOffset;
@@ -109,6 +121,7 @@ public:
 
     bool isRoot() const override { return false; }
     QString name() const override { return m_name; }
+    quint32 objectId() const override { return 0; }
 
     QString m_name;
 };
@@ -122,10 +135,12 @@ public:
 
     bool isRoot() const override { return true; }
     QString name() const override { return m_name; }
-    void addListener(IoDeviceBase *io, bool dynamic = false);
+    quint32 objectId() const override { return m_objectId; }
+    void addListener(IoDeviceBase *io, bool dynamic = false, const QVector<quint64> &propertyHashes = {});
     int removeListener(IoDeviceBase *io, bool shouldSendRemove = false);
 
     QString m_name;
+    quint32 m_objectId = 0; // assigned by QRemoteObjectSourceIo, 0 if names must be used
 };
 
 class DynamicApiMap final : public SourceApiMap
@@ -46,30 +46,61 @@
 #include "qtremoteobjectglobal.h"
 
 #include <QtCore/qstringlist.h>
+#include <QtCore/qtimer.h>
+
+#include <algorithm>
 
 QT_BEGIN_NAMESPACE
 
 using namespace QtRemoteObjects;
 
+// How long a greeted node holds one of the m_maxConcurrentHandshakes slots without answering
+static const int handshakeTimeout = 5000;
+
+// Instances created on each thread. A replica must not block on its socket on a thread
+// that may have to answer it, see existsOnCurrentThread().
+static thread_local int instancesOnThread = 0;
+
+// One call of an InvokeBatchPacket, decoded before any of them is invoked
+struct BatchedInvoke
+{
+    int call;
+    int index;
+    int serialId;
+    QVariantList args;
+};
+
 QRemoteObjectSourceIo::QRemoteObjectSourceIo(const QUrl &address, QObject *parent)
     : QObject(parent)
+    , m_sourceRootsById(1)
     , m_server(QtROServerFactory::instance()->isValid(address) ?
                QtROServerFactory::instance()->create(address, this) : nullptr)
     , m_address(address)
 {
+    ++instancesOnThread;
     if (m_server == nullptr)
         qRODebug(this) << "Using" << m_address << "as external url.";
 }
 
 QRemoteObjectSourceIo::QRemoteObjectSourceIo(QObject *parent)
     : QObject(parent)
+    , m_sourceRootsById(1)
     , m_server(nullptr)
 {
+    ++instancesOnThread;
 }
 
 QRemoteObjectSourceIo::~QRemoteObjectSourceIo()
 {
+    --instancesOnThread;
     qDeleteAll(m_sourceRoots.values());
+    qDeleteAll(m_deferredConnections);
+}
+
+// True if sources are served on the calling thread, which then has to keep processing events
+bool QRemoteObjectSourceIo::existsOnCurrentThread()
+{
+    return instancesOnThread > 0;
 }
 
 bool QRemoteObjectSourceIo::startListening()
@@ -132,7 +163,12 @@ void QRemoteObjectSourceIo::registerSource(QRemoteObjectSourceBase *source)
         QRemoteObjectRootSource *root = static_cast<QRemoteObjectRootSource *>(source);
         qRODebug(this) << "Registering" << name;
         m_sourceRoots[name] = root;
+        m_objectListPacket.clear();
         m_objectToSourceMap[source->m_object] = root;
+        if (!root->m_objectId && quint32(m_sourceRootsById.size()) <= maxObjectId) {
+            root->m_objectId = m_sourceRootsById.size();
+            m_sourceRootsById.append(root);
+        }
         if (serverAddress().isValid()) {
             const auto &type = source->m_api->typeName();
             emit remoteObjectAdded(qMakePair(name, QRemoteObjectSourceLocationInfo(type, serverAddress())));
@@ -149,6 +185,8 @@ void QRemoteObjectSourceIo::unregisterSource(QRemoteObjectSourceBase *source)
         const auto type = source->m_api->typeName();
         m_objectToSourceMap.remove(source->m_object);
         m_sourceRoots.remove(name);
+        m_objectListPacket.clear();
+        m_sourceRootsById[static_cast<QRemoteObjectRootSource *>(source)->m_objectId] = nullptr;
         if (serverAddress().isValid())
             emit remoteObjectRemoved(qMakePair(name, QRemoteObjectSourceLocationInfo(type, serverAddress())));
     }
@@ -157,10 +195,22 @@ void QRemoteObjectSourceIo::unregisterSource(QRemoteObjectSourceBase *source)
 void QRemoteObjectSourceIo::onServerDisconnect(QObject *conn)
 {
     IoDeviceBase *connection = qobject_cast<IoDeviceBase*>(conn);
-    m_connections.remove(connection);
+    // Closing the connection below can report the disconnect again
+    if (!m_connections.remove(connection))
+        return;
 
     qRODebug(this) << "OnServerDisconnect";
 
+    finishHandshake(connection);
+
+    m_suspendedConnections.remove(connection);
+    m_disconnectingConnections.remove(connection);
+    m_clientIds.remove(connection);
+    const auto ioThread = m_ioThreadOfConnection.constFind(connection);
+    if (ioThread != m_ioThreadOfConnection.cend()) {
+        --m_ioThreadLoad[*ioThread];
+        m_ioThreadOfConnection.erase(ioThread);
+    }
     for (QRemoteObjectRootSource *root : qAsConst(m_sourceRoots))
         root->removeListener(connection);
 
@@ -179,27 +229,39 @@ void QRemoteObjectSourceIo::onServerRead(QObject *conn)
 
     do {
 
-        if (!connection->read(packetType, m_rxName))
+        if (!connection->read(packetType, m_rxName, m_rxObjectId))
             return;
 
         using namespace QRemoteObjectPackets;
 
         switch (packetType) {
+        case Handshake:
+        {
+            // Only sent by nodes that want to negotiate capabilities the host announced
+            quint32 capabilities;
+            deserializeHandshakePacket(connection->stream(), capabilities);
+            if (m_compressionThreshold > 0 && (capabilities & CompressionCapability))
+                connection->setCompressionThreshold(m_compressionThreshold);
+            break;
+        }
         case Ping:
-            serializePongPacket(m_packet, m_rxName);
+            ++m_receivedPings;
+            serializePongPacket(m_packet, m_rxName, m_rxObjectId);
             connection->write(m_packet.array, m_packet.size);
             break;
         case AddObject:
         {
             bool isDynamic;
-            deserializeAddObjectPacket(connection->stream(), isDynamic);
-            qRODebug(this) << "AddObject" << m_rxName << isDynamic;
+            deserializeAddObjectPacket(connection->stream(), isDynamic, m_rxPropertyHashes);
+            qRODebug(this) << "AddObject" << m_rxName << isDynamic << m_rxPropertyHashes.size();
             if (m_sourceRoots.contains(m_rxName)) {
                 QRemoteObjectRootSource *root = m_sourceRoots[m_rxName];
-                root->addListener(connection, isDynamic);
+                root->addListener(connection, isDynamic, m_rxPropertyHashes);
             } else {
                 qROWarning(this) << "Request to attach to non-existent RemoteObjectSource:" << m_rxName;
             }
+            // The node is served once its first Init was written
+            finishHandshake(connection);
             break;
         }
         case RemoveObject:
@@ -218,69 +280,63 @@ void QRemoteObjectSourceIo::onServerRead(QObject *conn)
         }
         case InvokePacket:
         {
-            int call, index, serialId, propertyId;
-            deserializeInvokePacket(connection->stream(), call, index, m_rxArgs, serialId, propertyId);
-            if (m_rxName == QLatin1String("Registry") && !m_registryMapping.contains(connection)) {
-                const QRemoteObjectSourceLocation loc = m_rxArgs.first().value<QRemoteObjectSourceLocation>();
-                m_registryMapping[connection] = loc.second.hostUrl;
+            // Packets using an id the connection doesn't know (anymore) resolve to an empty name
+            QRemoteObjectSourceBase *source = m_rxObjectId
+                    ? (m_rxName.isEmpty() ? nullptr : m_sourceRootsById.value(int(m_rxObjectId)))
+                    : m_sourceObjects.value(m_rxName);
+            // The whole packet is buffered, so calls to removed sources are dropped undecoded
+            if (source) {
+                int call, index, serialId, propertyId;
+                deserializeInvokePacket(connection->stream(), call, index, m_rxArgs, serialId, propertyId);
+                if (m_rxName == QLatin1String("Registry") && !m_registryMapping.contains(connection)) {
+                    const QRemoteObjectSourceLocation loc = m_rxArgs.first().value<QRemoteObjectSourceLocation>();
+                    m_registryMapping[connection] = loc.second.hostUrl;
+                }
+                handleInvoke(connection, source, m_rxName, m_rxObjectId, call, index, serialId);
             }
-            if (m_sourceObjects.contains(m_rxName)) {
-                QRemoteObjectSourceBase *source = m_sourceObjects[m_rxName];
-                if (call == QMetaObject::InvokeMetaMethod) {
-                    const int resolvedIndex = source->m_api->sourceMethodIndex(index);
-                    if (resolvedIndex < 0) { //Invalid index
-                        qROWarning(this) << "Invalid method invoke packet received.  Index =" << index <<"which is out of bounds for type"<<m_rxName;
-                        //TODO - consider moving this to packet validation?
-                        break;
-                    }
-                    if (source->m_api->isAdapterMethod(index))
-                        qRODebug(this) << "Adapter (method) Invoke-->" << m_rxName << source->m_adapter->metaObject()->method(resolvedIndex).name();
-                    else {
-                        qRODebug(this) << "Source (method) Invoke-->" << m_rxName << source->m_object->metaObject()->method(resolvedIndex).methodSignature();
-                        auto method = source->m_object->metaObject()->method(resolvedIndex);
-                        const int parameterCount = method.parameterCount();
-                        for (int i = 0; i < parameterCount; i++)
-                            decodeVariant(m_rxArgs[i], method.parameterType(i));
-                    }
-                    int typeId = QMetaType::type(source->m_api->typeName(index).constData());
-                    if (!QMetaType(typeId).sizeOf())
-                        typeId = QVariant::Invalid;
-                    QVariant returnValue(typeId, nullptr);
-                    // If a Replica is used as a Source (which node->proxy() does) we can have a PendingCall return value.
-                    // In this case, we need to wait for the pending call and send that.
-                    if (source->m_api->typeName(index) == QByteArrayLiteral("QRemoteObjectPendingCall"))
-                        returnValue = QVariant::fromValue<QRemoteObjectPendingCall>(QRemoteObjectPendingCall());
-                    source->invoke(QMetaObject::InvokeMetaMethod, index, m_rxArgs, &returnValue);
-                    // send reply if wanted
-                    if (serialId >= 0) {
-                        if (returnValue.canConvert<QRemoteObjectPendingCall>()) {
-                            QRemoteObjectPendingCall call = returnValue.value<QRemoteObjectPendingCall>();
-                            // Watcher will be destroyed when connection is, or when the finished lambda is called
-                            QRemoteObjectPendingCallWatcher *watcher = new QRemoteObjectPendingCallWatcher(call, connection);
-                            QObject::connect(watcher, &QRemoteObjectPendingCallWatcher::finished, connection, [this, serialId, connection, watcher]() {
-                                if (watcher->error() == QRemoteObjectPendingCall::NoError) {
-                                    serializeInvokeReplyPacket(this->m_packet, this->m_rxName, serialId, encodeVariant(watcher->returnValue()));
-                                    connection->write(m_packet.array, m_packet.size);
-                                }
-                                watcher->deleteLater();
-                            });
-                        } else {
-                            serializeInvokeReplyPacket(m_packet, m_rxName, serialId, encodeVariant(returnValue));
-                            connection->write(m_packet.array, m_packet.size);
-                        }
-                    }
-                } else {
-                    const int resolvedIndex = source->m_api->sourcePropertyIndex(index);
-                    if (resolvedIndex < 0) {
-                        qROWarning(this) << "Invalid property invoke packet received.  Index =" << index <<"which is out of bounds for type"<<m_rxName;
-                        //TODO - consider moving this to packet validation?
+            break;
+        }
+        case InvokeBatchPacket:
+        {
+            QPointer<QRemoteObjectSourceBase> source = m_rxObjectId
+                    ? (m_rxName.isEmpty() ? nullptr : m_sourceRootsById.value(int(m_rxObjectId)))
+                    : m_sourceObjects.value(m_rxName);
+            if (source) {
+                // Invoked methods can process events, which would overwrite the m_rx members and
+                // read the next packet from the stream, so everything is decoded up front
+                const QString name = m_rxName;
+                const quint32 objectId = m_rxObjectId;
+                QDataStream &in = connection->stream();
+                quint32 count;
+                deserializeInvokeBatchPacket(in, count);
+                QVector<BatchedInvoke> calls;
+                // The count comes from the peer, each call takes more than one byte of the packet
+                calls.reserve(int(qMin(qint64(count), in.device()->bytesAvailable())));
+                for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+                    BatchedInvoke batched;
+                    int propertyId;
+                    deserializeInvokePacket(in, batched.call, batched.index, batched.args, batched.serialId, propertyId);
+                    calls.append(batched);
+                }
+                if (in.status() != QDataStream::Ok) {
+                    qROWarning(this) << "Malformed InvokeBatchPacket received for" << name;
+                    break;
+                }
+
+                QPointer<IoDeviceBase> guard(connection);
+                QVector<QPair<int, QVariant>> replies;
+                for (const BatchedInvoke &batched : qAsConst(calls)) {
+                    // The source or the connection may be gone after an earlier call
+                    if (!source || !guard)
                         break;
-                    }
-                    if (source->m_api->isAdapterProperty(index))
-                        qRODebug(this) << "Adapter (write property) Invoke-->" << m_rxName << source->m_adapter->metaObject()->property(resolvedIndex).name();
-                    else
-                        qRODebug(this) << "Source (write property) Invoke-->" << m_rxName << source->m_object->metaObject()->property(resolvedIndex).name();
-                    source->invoke(QMetaObject::WriteProperty, index, m_rxArgs);
+                    m_rxArgs = batched.args;
+                    handleInvoke(connection, source, name, objectId, batched.call, batched.index, batched.serialId, &replies);
+                }
+                if (!guard)
+                    return;
+                if (!replies.isEmpty()) {
+                    serializeInvokeBatchReplyPacket(m_packet, name, objectId, replies);
+                    connection->write(m_packet.array, m_packet.size, name);
                 }
             }
             break;
@@ -291,12 +347,144 @@ void QRemoteObjectSourceIo::onServerRead(QObject *conn)
     } while (connection->bytesAvailable()); // have bytes left over, so do another iteration
 }
 
+// Replies are sent right away, or collected in replies for a batch
+void QRemoteObjectSourceIo::handleInvoke(IoDeviceBase *connection, QRemoteObjectSourceBase *source,
+                                         const QString &name, quint32 objectId, int call, int index,
+                                         int serialId, QVector<QPair<int, QVariant>> *replies)
+{
+    if (call == QMetaObject::InvokeMetaMethod) {
+        const int resolvedIndex = source->m_api->sourceMethodIndex(index);
+        if (resolvedIndex < 0) { //Invalid index
+            qROWarning(this) << "Invalid method invoke packet received.  Index =" << index <<"which is out of bounds for type"<<name;
+            //TODO - consider moving this to packet validation?
+            return;
+        }
+        if (source->m_api->isAdapterMethod(index))
+            qRODebug(this) << "Adapter (method) Invoke-->" << name << source->m_adapter->metaObject()->method(resolvedIndex).name();
+        else {
+            qRODebug(this) << "Source (method) Invoke-->" << name << source->m_object->metaObject()->method(resolvedIndex).methodSignature();
+            auto method = source->m_object->metaObject()->method(resolvedIndex);
+            const int parameterCount = method.parameterCount();
+            for (int i = 0; i < parameterCount; i++)
+                decodeVariant(m_rxArgs[i], method.parameterType(i));
+        }
+        int typeId = QMetaType::type(source->m_api->typeName(index).constData());
+        if (!QMetaType(typeId).sizeOf())
+            typeId = QVariant::Invalid;
+        QVariant returnValue(typeId, nullptr);
+        // If a Replica is used as a Source (which node->proxy() does) we can have a PendingCall return value.
+        // In this case, we need to wait for the pending call and send that.
+        if (source->m_api->typeName(index) == QByteArrayLiteral("QRemoteObjectPendingCall"))
+            returnValue = QVariant::fromValue<QRemoteObjectPendingCall>(QRemoteObjectPendingCall());
+        source->invoke(QMetaObject::InvokeMetaMethod, index, m_rxArgs, &returnValue);
+        // send reply if wanted
+        if (serialId >= 0) {
+            if (returnValue.canConvert<QRemoteObjectPendingCall>()) {
+                QRemoteObjectPendingCall call = returnValue.value<QRemoteObjectPendingCall>();
+                // Watcher will be destroyed when connection is, or when the finished lambda is called
+                QRemoteObjectPendingCallWatcher *watcher = new QRemoteObjectPendingCallWatcher(call, connection);
+                QObject::connect(watcher, &QRemoteObjectPendingCallWatcher::finished, connection, [this, serialId, connection, watcher, name, objectId]() {
+                    if (watcher->error() == QRemoteObjectPendingCall::NoError) {
+                        serializeInvokeReplyPacket(this->m_packet, name, objectId, serialId, encodeVariant(watcher->returnValue()));
+                        connection->write(m_packet.array, m_packet.size, name);
+                    }
+                    watcher->deleteLater();
+                });
+            } else if (replies) {
+                replies->append(qMakePair(serialId, encodeVariant(returnValue)));
+            } else {
+                serializeInvokeReplyPacket(m_packet, name, objectId, serialId, encodeVariant(returnValue));
+                connection->write(m_packet.array, m_packet.size, name);
+            }
+        }
+    } else {
+        const int resolvedIndex = source->m_api->sourcePropertyIndex(index);
+        if (resolvedIndex < 0) {
+            qROWarning(this) << "Invalid property invoke packet received.  Index =" << index <<"which is out of bounds for type"<<name;
+            //TODO - consider moving this to packet validation?
+            return;
+        }
+        if (source->m_api->isAdapterProperty(index))
+            qRODebug(this) << "Adapter (write property) Invoke-->" << name << source->m_adapter->metaObject()->property(resolvedIndex).name();
+        else
+            qRODebug(this) << "Source (write property) Invoke-->" << name << source->m_object->metaObject()->property(resolvedIndex).name();
+        source->invoke(QMetaObject::WriteProperty, index, m_rxArgs);
+    }
+}
+
 void QRemoteObjectSourceIo::handleConnection()
 {
     qRODebug(this) << "handleConnection" << m_connections;
 
     ServerIoDevice *conn = m_server->nextPendingConnection();
+    if (m_maxConcurrentHandshakes > 0 && m_handshaking.size() >= m_maxConcurrentHandshakes) {
+        // Greeted once another node is done, so a host restart doesn't serve every node at once
+        qRODebug(this) << "Deferring connection," << m_handshaking.size() << "handshakes in progress";
+        m_deferredConnections.append(conn);
+        connect(conn, &IoDeviceBase::disconnected, this, [this, conn]() {
+            if (m_deferredConnections.removeOne(conn)) {
+                conn->close();
+                conn->deleteLater();
+            }
+        });
+        return;
+    }
+    acceptConnection(conn);
+}
+
+void QRemoteObjectSourceIo::acceptConnection(ServerIoDevice *conn)
+{
+    if (m_ioThreadEnabled)
+        assignIoThread(conn);
     newConnection(conn);
+    if (m_maxConcurrentHandshakes > 0) {
+        m_handshaking.insert(conn);
+        // Nodes without replicas to acquire might never answer
+        QTimer::singleShot(handshakeTimeout, conn, [this, conn]() { finishHandshake(conn); });
+    }
+}
+
+// The node got its first Init or left, let the next deferred connection in
+void QRemoteObjectSourceIo::finishHandshake(IoDeviceBase *conn)
+{
+    if (m_handshaking.remove(conn))
+        acceptDeferredConnections();
+}
+
+void QRemoteObjectSourceIo::acceptDeferredConnections()
+{
+    while (!m_deferredConnections.isEmpty()
+           && (m_maxConcurrentHandshakes <= 0 || m_handshaking.size() < m_maxConcurrentHandshakes)) {
+        acceptConnection(m_deferredConnections.takeFirst());
+    }
+}
+
+void QRemoteObjectSourceIo::setMaxConcurrentHandshakes(int count)
+{
+    m_maxConcurrentHandshakes = count;
+    acceptDeferredConnections();
+}
+
+// Picks the I/O thread with the fewest connections, starting up to m_ioThreadCount of them
+void QRemoteObjectSourceIo::assignIoThread(IoDeviceBase *conn)
+{
+    int index = -1;
+    if (!m_ioThreadLoad.isEmpty())
+        index = int(std::min_element(m_ioThreadLoad.cbegin(), m_ioThreadLoad.cend()) - m_ioThreadLoad.cbegin());
+    QSharedPointer<IoThread> newThread;
+    if ((index < 0 || m_ioThreadLoad.at(index) > 0) && m_ioThreads.size() < m_ioThreadCount)
+        newThread = QSharedPointer<IoThread>::create();
+    // Started only once it has a socket to serve, otherwise the connection stays on this thread
+    if (!conn->setIoThread(newThread ? newThread.data() : m_ioThreads.at(index).data()))
+        return;
+    if (newThread) {
+        newThread->start();
+        m_ioThreads.append(newThread);
+        m_ioThreadLoad.append(0);
+        index = m_ioThreads.size() - 1;
+    }
+    ++m_ioThreadLoad[index];
+    m_ioThreadOfConnection.insert(conn, index);
 }
 
 void QRemoteObjectSourceIo::newConnection(IoDeviceBase *conn)
@@ -308,20 +496,103 @@ void QRemoteObjectSourceIo::newConnection(IoDeviceBase *conn)
     connect(conn, &IoDeviceBase::disconnected, this, [this, conn]() {
         onServerDisconnect(conn);
     });
+    m_clientIds.insert(conn, ++m_lastClientId);
+    connect(conn, &IoDeviceBase::sendQueueHighWatermarkReached, this, [this, conn](qint64 queuedBytes) {
+        onSendQueueHighWatermarkReached(conn, queuedBytes);
+    });
+    connect(conn, &IoDeviceBase::sendQueueLowWatermarkReached, this, [this, conn](qint64 queuedBytes) {
+        onSendQueueLowWatermarkReached(conn, queuedBytes);
+    });
+    connect(conn, &IoDeviceBase::sendQueueOverflowed, this, [this, conn](qint64 heldBackBytes) {
+        onSendQueueOverflowed(conn, heldBackBytes);
+    });
+    connect(conn, &IoDeviceBase::packetsDropped, this, [this](int count) {
+        m_droppedPackets += quint64(count);
+    });
 
-    serializeHandshakePacket(m_packet);
+    serializeHandshakePacket(m_packet, m_compressionThreshold > 0 ? CompressionCapability : 0);
     conn->write(m_packet.array, m_packet.size);
-
-    QRemoteObjectPackets::ObjectInfoList infos;
-    infos.reserve(m_sourceRoots.size());
-    for (auto remoteObject : qAsConst(m_sourceRoots)) {
-        infos << QRemoteObjectPackets::ObjectInfo{remoteObject->m_api->name(), remoteObject->m_api->typeName(), remoteObject->m_api->objectSignature()};
+    // Nodes that don't understand Batch packets must still be able to read the handshake
+    conn->flush();
+    conn->setLegacyProtocol(false);
+    conn->setSendQueueLimits(m_highWatermark, m_lowWatermark, m_sendQueuePolicy);
+
+    if (m_objectListPacket.isEmpty()) {
+        QRemoteObjectPackets::ObjectInfoList infos;
+        infos.reserve(m_sourceRoots.size());
+        for (auto remoteObject : qAsConst(m_sourceRoots)) {
+            infos << QRemoteObjectPackets::ObjectInfo{remoteObject->m_api->name(), remoteObject->m_api->typeName(), remoteObject->m_api->objectSignature()};
+        }
+        serializeObjectListPacket(m_packet, infos);
+        m_objectListPacket = m_packet.array.left(m_packet.size);
     }
-    serializeObjectListPacket(m_packet, infos);
-    conn->write(m_packet.array, m_packet.size);
+    conn->write(m_objectListPacket);
     qRODebug(this) << "Wrote ObjectList packet from Server" << QStringList(m_sourceRoots.keys());
 }
 
+void QRemoteObjectSourceIo::setSendQueueLimits(qint64 highWatermark, qint64 lowWatermark, QRemoteObjectHostBase::SendQueuePolicy policy)
+{
+    m_highWatermark = highWatermark;
+    m_lowWatermark = lowWatermark;
+    m_sendQueuePolicy = policy;
+    for (IoDeviceBase *conn : qAsConst(m_connections))
+        conn->setSendQueueLimits(highWatermark, lowWatermark, policy);
+}
+
+void QRemoteObjectSourceIo::onSendQueueHighWatermarkReached(IoDeviceBase *conn, qint64 queuedBytes)
+{
+    const int clientId = m_clientIds.value(conn);
+    qRODebug(this) << "Send queue of client" << clientId << "is full:" << queuedBytes << "bytes";
+    emit sendQueueHighWatermarkReached(clientId, queuedBytes);
+
+    switch (m_sendQueuePolicy) {
+    case QRemoteObjectHostBase::DisconnectClient:
+        qROWarning(this) << "Disconnecting client" << clientId << "with" << queuedBytes << "bytes queued";
+        disconnectCongested(conn);
+        break;
+    case QRemoteObjectHostBase::SuspendClient:
+        qRODebug(this) << "Suspending client" << clientId;
+        m_suspendedConnections.insert(conn);
+        break;
+    default:
+        break;
+    }
+}
+
+void QRemoteObjectSourceIo::onSendQueueOverflowed(IoDeviceBase *conn, qint64 heldBackBytes)
+{
+    if (!m_connections.contains(conn) || m_disconnectingConnections.contains(conn))
+        return;
+    qROWarning(this) << "Disconnecting client" << m_clientIds.value(conn) << "with" << heldBackBytes
+                     << "bytes held back while congested";
+    disconnectCongested(conn);
+}
+
+void QRemoteObjectSourceIo::disconnectCongested(IoDeviceBase *conn)
+{
+    if (m_disconnectingConnections.contains(conn))
+        return;
+    m_disconnectingConnections.insert(conn);
+    ++m_backpressureDisconnects;
+    // We are likely in the middle of sending to all listeners, so don't touch them right now
+    QPointer<IoDeviceBase> connection(conn);
+    QMetaObject::invokeMethod(this, [this, connection]() {
+        if (connection)
+            onServerDisconnect(connection);
+    }, Qt::QueuedConnection);
+}
+
+void QRemoteObjectSourceIo::onSendQueueLowWatermarkReached(IoDeviceBase *conn, qint64 queuedBytes)
+{
+    const int clientId = m_clientIds.value(conn);
+    qRODebug(this) << "Send queue of client" << clientId << "drained to" << queuedBytes << "bytes";
+    if (m_suspendedConnections.remove(conn)) {
+        for (QRemoteObjectRootSource *root : qAsConst(m_sourceRoots))
+            root->resendStaleProperties(conn);
+    }
+    emit sendQueueLowWatermarkReached(clientId, queuedBytes);
+}
+
 QUrl QRemoteObjectSourceIo::serverAddress() const
 {
     if (m_server)
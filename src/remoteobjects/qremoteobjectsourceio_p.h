@@ -57,6 +57,7 @@
 
 #include <QtCore/qiodevice.h>
 #include <QtCore/qscopedpointer.h>
+#include <QtCore/qsharedpointer.h>
 
 QT_BEGIN_NAMESPACE
 
@@ -79,8 +80,11 @@ public:
     bool enableRemoting(QObject *object, const SourceApiMap *api, QObject *adapter = nullptr);
     bool disableRemoting(QObject *object);
     void newConnection(IoDeviceBase *conn);
+    void setSendQueueLimits(qint64 highWatermark, qint64 lowWatermark, QRemoteObjectHostBase::SendQueuePolicy policy);
+    void setMaxConcurrentHandshakes(int count);
 
     QUrl serverAddress() const;
+    static bool existsOnCurrentThread();
 
 public Q_SLOTS:
     void handleConnection();
@@ -91,21 +95,59 @@ Q_SIGNALS:
     void remoteObjectAdded(const QRemoteObjectSourceLocation &);
     void remoteObjectRemoved(const QRemoteObjectSourceLocation &);
     void serverRemoved(const QUrl& url);
+    void sendQueueHighWatermarkReached(int clientId, qint64 queuedBytes);
+    void sendQueueLowWatermarkReached(int clientId, qint64 queuedBytes);
 
 public:
     void registerSource(QRemoteObjectSourceBase *source);
     void unregisterSource(QRemoteObjectSourceBase *source);
+    void onSendQueueHighWatermarkReached(IoDeviceBase *conn, qint64 queuedBytes);
+    void onSendQueueLowWatermarkReached(IoDeviceBase *conn, qint64 queuedBytes);
+    void onSendQueueOverflowed(IoDeviceBase *conn, qint64 heldBackBytes);
+    void disconnectCongested(IoDeviceBase *conn);
+    void handleInvoke(IoDeviceBase *connection, QRemoteObjectSourceBase *source, const QString &name,
+                      quint32 objectId, int call, int index, int serialId,
+                      QVector<QPair<int, QVariant>> *replies = nullptr);
+    void assignIoThread(IoDeviceBase *conn);
+    void acceptConnection(ServerIoDevice *conn);
+    void finishHandshake(IoDeviceBase *conn);
+    void acceptDeferredConnections();
 
     QHash<QIODevice*, quint32> m_readSize;
     QSet<IoDeviceBase*> m_connections;
     QHash<QObject *, QRemoteObjectRootSource*> m_objectToSourceMap;
     QMap<QString, QRemoteObjectSourceBase*> m_sourceObjects;
     QMap<QString, QRemoteObjectRootSource*> m_sourceRoots;
+    // Indexed by object id.  Ids are never reused, so a late packet can't reach a new source.
+    QVector<QRemoteObjectRootSource*> m_sourceRootsById;
     QHash<IoDeviceBase*, QUrl> m_registryMapping;
+    QHash<IoDeviceBase*, int> m_clientIds;
+    int m_lastClientId = 0;
+    qint64 m_highWatermark = 0;
+    qint64 m_lowWatermark = 0;
+    QRemoteObjectHostBase::SendQueuePolicy m_sendQueuePolicy = QRemoteObjectHostBase::DropOldestPackets;
+    int m_compressionThreshold = 0;
+    bool m_ioThreadEnabled = false;
+    int m_ioThreadCount = 1;
+    // Declared before m_server, the connections it owns have to go first
+    QVector<QSharedPointer<IoThread>> m_ioThreads;
+    QVector<int> m_ioThreadLoad; // connections per thread in m_ioThreads
+    QHash<IoDeviceBase*, int> m_ioThreadOfConnection;
+    QSet<IoDeviceBase*> m_suspendedConnections; // over their high watermark with SuspendClient
+    QSet<IoDeviceBase*> m_disconnectingConnections; // disconnect already scheduled, see disconnectCongested()
+    int m_maxConcurrentHandshakes = 0;
+    QSet<IoDeviceBase*> m_handshaking; // greeted, until the first Init for the node was written, it left or timed out
+    QVector<ServerIoDevice*> m_deferredConnections; // accepted while m_handshaking was full
+    quint64 m_droppedPackets = 0;
+    quint64 m_backpressureDisconnects = 0;
+    quint64 m_receivedPings = 0; // only used by tests
     QScopedPointer<QConnectionAbstractServer> m_server;
     QRemoteObjectPackets::DataStreamPacket m_packet;
+    QByteArray m_objectListPacket; // sent to every new connection, cleared when m_sourceRoots changes
     QString m_rxName;
+    quint32 m_rxObjectId = 0;
     QVariantList m_rxArgs;
+    QVector<quint64> m_rxPropertyHashes;
     QUrl m_address;
 };
 
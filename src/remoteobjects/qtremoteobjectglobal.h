@@ -114,6 +114,7 @@ namespace QRemoteObjectStringLiterals {
 
 inline QString local() { return QStringLiteral("local"); }
 inline QString tcp() { return QStringLiteral("tcp"); }
+inline QString shm() { return QStringLiteral("shm"); }
 inline QString CLASS() { return QStringLiteral("Class::%1"); }
 inline QString MODEL() { return QStringLiteral("Model::%1"); }
 inline QString QAIMADAPTER() { return QStringLiteral("QAbstractItemModelAdapter"); }
@@ -165,7 +166,13 @@ enum QRemoteObjectPacketTypeEnum
     PropertyChangePacket,
     ObjectList,
     Ping,
-    Pong
+    Pong,
+    Batch,
+    InitDeltaPacket,
+    CompactPropertyChangePacket,
+    CompressedBatch,
+    InvokeBatchPacket,
+    InvokeBatchReplyPacket
 };
 Q_ENUM_NS(QRemoteObjectPacketTypeEnum)
 
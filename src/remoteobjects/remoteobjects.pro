@@ -60,6 +60,14 @@ SOURCES += \
     qremoteobjectsourceio.cpp \
     qtremoteobjectglobal.cpp
 
+qtConfig(sharedmemory) {
+    SOURCES += \
+        qconnection_shm_backend.cpp
+
+    HEADERS += \
+        qconnection_shm_backend_p.h
+}
+
 qnx {
     SOURCES += \
         qconnection_qnx_backend.cpp \
@@ -1,4 +1,4 @@
-QT       += network testlib remoteobjects
+QT       += network testlib remoteobjects remoteobjects-private
 
 QT       -= gui
 
@@ -30,12 +30,40 @@
 #include <QDataStream>
 #include <QLocalSocket>
 #include <QLocalServer>
+#include <QIdentityProxyModel>
 #include <QtTest>
 #include <QtRemoteObjects/QAbstractItemModelReplica>
 #include <QtRemoteObjects/QRemoteObjectNode>
+#include <QtRemoteObjects/private/qremoteobjectpacket_p.h>
 #include "rep_localdatacenter_replica.h"
 #include "rep_localdatacenter_source.h"
 
+#if defined(Q_OS_WIN)
+#include <qt_windows.h>
+#elif defined(Q_OS_UNIX)
+#include <time.h>
+#include <unistd.h>
+#endif
+
+// CPU time the calling thread used so far, in nanoseconds, or -1 if unknown
+static qint64 threadCpuTime()
+{
+#if defined(Q_OS_WIN)
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+        return -1;
+    const auto ticks = [](const FILETIME &t) { return (qint64(t.dwHighDateTime) << 32) | t.dwLowDateTime; };
+    return (ticks(kernel) + ticks(user)) * 100;
+#elif defined(_POSIX_THREAD_CPUTIME) && _POSIX_THREAD_CPUTIME >= 0
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+        return -1;
+    return qint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#else
+    return -1;
+#endif
+}
+
 class BenchmarksModel : public QAbstractListModel
 {
     // QAbstractItemModel interface
@@ -71,6 +99,80 @@ QHash<int, QByteArray> BenchmarksModel::roleNames() const
     return roleNames;
 }
 
+// A model whose rows only exist as a count, for inserting into a very large model
+class GrowingModel : public QAbstractListModel
+{
+public:
+    int rowCount(const QModelIndex &parent) const override
+    {
+        return parent.isValid() ? 0 : m_rowCount;
+    }
+    QVariant data(const QModelIndex &index, int role) const override
+    {
+        return role == Qt::DisplayRole ? QVariant(index.row()) : QVariant();
+    }
+    void insertAtTop(int count)
+    {
+        beginInsertRows(QModelIndex(), 0, count - 1);
+        m_rowCount += count;
+        endInsertRows();
+    }
+
+private:
+    int m_rowCount = 1000000;
+};
+
+// A 100k x 20 table with 8 user roles per cell
+class WideModel : public QAbstractTableModel
+{
+public:
+    enum { RoleCount = 8 };
+
+    int rowCount(const QModelIndex &parent) const override
+    {
+        return parent.isValid() ? 0 : 100000;
+    }
+    int columnCount(const QModelIndex &parent) const override
+    {
+        return parent.isValid() ? 0 : 20;
+    }
+    QVariant data(const QModelIndex &index, int role) const override
+    {
+        if (role < Qt::UserRole || role >= Qt::UserRole + RoleCount)
+            return QVariant();
+        return index.row() * 20 + index.column() + role - Qt::UserRole;
+    }
+    // Resolves the cell once for all requested roles
+    void multiData(const QModelIndex &index, QModelRoleDataSpan roleDataSpan) const override
+    {
+        const int cell = index.row() * 20 + index.column();
+        for (QModelRoleData &roleData : roleDataSpan) {
+            const int role = roleData.role();
+            if (role < Qt::UserRole || role >= Qt::UserRole + RoleCount)
+                roleData.clearData();
+            else
+                roleData.setData(cell + role - Qt::UserRole);
+        }
+    }
+    static QVector<int> roles()
+    {
+        QVector<int> result;
+        for (int i = 0; i < RoleCount; ++i)
+            result << Qt::UserRole + i;
+        return result;
+    }
+};
+
+// Maps the index once and hands all roles to the source model's multiData()
+class WideProxyModel : public QIdentityProxyModel
+{
+public:
+    void multiData(const QModelIndex &index, QModelRoleDataSpan roleDataSpan) const override
+    {
+        sourceModel()->multiData(mapToSource(index), roleDataSpan);
+    }
+};
+
 class BenchmarksTest : public QObject
 {
     Q_OBJECT
@@ -86,11 +188,27 @@ private:
 private Q_SLOTS:
     void initTestCase();
     void benchPropertyChangesInt();
+    void benchInitializeReplicas_data();
+    void benchInitializeReplicas();
     void benchQDataStreamInt();
+    void benchQDataStreamVariant_data();
+    void benchQDataStreamVariant();
+    void benchCompactValue_data();
+    void benchCompactValue();
+    void benchCompression_data();
+    void benchCompression();
     void benchQLocalSocketInt();
+    void benchTransportPropertyChangesInt_data();
+    void benchTransportPropertyChangesInt();
+    void benchIoThreadReceive_data();
+    void benchIoThreadReceive();
     void benchQLocalSocketQDataStreamInt();
     void benchModelLinearAccess();
     void benchModelRandomAccess();
+    void benchModelTopInsert_data();
+    void benchModelTopInsert();
+    void benchModelMultiRoleFetch_data();
+    void benchModelMultiRoleFetch();
 };
 
 BenchmarksTest::BenchmarksTest()
@@ -137,6 +255,43 @@ void BenchmarksTest::benchPropertyChangesInt()
         loop.exec();
     }
 }
+
+void BenchmarksTest::benchInitializeReplicas_data()
+{
+    QTest::addColumn<int>("clientCount");
+    QTest::newRow("1 client") << 1;
+    QTest::newRow("100 clients") << 100;
+    QTest::newRow("1000 clients") << 1000;
+}
+
+// Measures how long it takes until every client has an initialized replica of the same source
+void BenchmarksTest::benchInitializeReplicas()
+{
+    QFETCH(int, clientCount);
+    QBENCHMARK {
+        QVector<QRemoteObjectNode *> clients;
+        QVector<LocalDataCenterReplica *> replicas;
+        QEventLoop loop;
+        int initialized = 0;
+        for (int i = 0; i < clientCount; ++i) {
+            QRemoteObjectNode *client = new QRemoteObjectNode;
+            client->connectToNode(QUrl(QStringLiteral("local:benchmark_replica")));
+            LocalDataCenterReplica *replica = client->acquire<LocalDataCenterReplica>();
+            connect(replica, &LocalDataCenterReplica::initialized, [&initialized, &loop, clientCount]() {
+                if (++initialized == clientCount)
+                    loop.quit();
+            });
+            clients.append(client);
+            replicas.append(replica);
+        }
+        QTimer::singleShot(30000, &loop, &QEventLoop::quit);
+        loop.exec();
+        QCOMPARE(initialized, clientCount);
+        qDeleteAll(replicas);
+        qDeleteAll(clients);
+    }
+}
+
 // This ONLY tests the optimal case of a non resizing QByteArray
 void BenchmarksTest::benchQDataStreamInt()
 {
@@ -155,6 +310,108 @@ void BenchmarksTest::benchQDataStreamInt()
     }
 }
 
+static void addValueRows()
+{
+    QTest::addColumn<QVariant>("value");
+
+    QTest::newRow("smallInt") << QVariant(42);
+    QTest::newRow("negativeInt") << QVariant(-42);
+    QTest::newRow("largeInt") << QVariant(std::numeric_limits<int>::max());
+    QTest::newRow("double") << QVariant(3.14);
+    QTest::newRow("string") << QVariant(QStringLiteral("Remote objects"));
+}
+
+// The QVariant envelope PropertyChangePacket uses
+void BenchmarksTest::benchQDataStreamVariant_data()
+{
+    addValueRows();
+}
+
+void BenchmarksTest::benchQDataStreamVariant()
+{
+    QFETCH(QVariant, value);
+
+    QByteArray buffer;
+    QVariant readout;
+    QBENCHMARK {
+        buffer.clear();
+        QDataStream stream(&buffer, QIODevice::WriteOnly);
+        for (int i = 0; i < 50000; ++i)
+            stream << value;
+        QDataStream rStream(&buffer, QIODevice::ReadOnly);
+        for (int i = 0; i < 50000; ++i) {
+            rStream >> readout;
+            Q_ASSERT(readout == value);
+        }
+    }
+    qDebug() << "bytes per value:" << buffer.size() / 50000;
+}
+
+// The encoding CompactPropertyChangePacket uses for replicas with a matching signature
+void BenchmarksTest::benchCompactValue_data()
+{
+    addValueRows();
+}
+
+void BenchmarksTest::benchCompactValue()
+{
+    QFETCH(QVariant, value);
+
+    const int wireType = QRemoteObjectPackets::compactWireType(value.userType());
+    QVERIFY(wireType != QMetaType::UnknownType);
+    QByteArray buffer;
+    QVariant readout;
+    QBENCHMARK {
+        buffer.clear();
+        QDataStream stream(&buffer, QIODevice::WriteOnly);
+        for (int i = 0; i < 50000; ++i)
+            QRemoteObjectPackets::writeCompactValue(stream, value, wireType);
+        QDataStream rStream(&buffer, QIODevice::ReadOnly);
+        for (int i = 0; i < 50000; ++i) {
+            QRemoteObjectPackets::readCompactValue(rStream, readout, wireType, buffer.size());
+            Q_ASSERT(readout == value);
+        }
+    }
+    qDebug() << "bytes per value:" << buffer.size() / 50000;
+}
+
+// qCompress() is what CompressedBatch packets use, see QRemoteObjectNode::compressionThreshold
+void BenchmarksTest::benchCompression_data()
+{
+    QTest::addColumn<QByteArray>("payload");
+    QTest::addColumn<int>("level");
+
+    // Roughly what a model replica receives, the rows of the benchmark model
+    QByteArray modelData;
+    {
+        QDataStream stream(&modelData, QIODevice::WriteOnly);
+        for (int i = 0; i < 10000; ++i)
+            stream << QVariant(QString::number(i)) << QVariant(i);
+    }
+    QByteArray randomData(modelData.size(), Qt::Uninitialized);
+    for (int i = 0; i < randomData.size(); ++i)
+        randomData[i] = char(QRandomGenerator::global()->bounded(256));
+
+    QTest::newRow("modelData/fastest") << modelData << 1;
+    QTest::newRow("modelData/default") << modelData << -1;
+    QTest::newRow("modelData/best") << modelData << 9;
+    QTest::newRow("random/default") << randomData << -1;
+}
+
+void BenchmarksTest::benchCompression()
+{
+    QFETCH(QByteArray, payload);
+    QFETCH(int, level);
+
+    QByteArray compressed;
+    QBENCHMARK {
+        compressed = qCompress(payload, level);
+        QByteArray uncompressed = qUncompress(compressed);
+        Q_ASSERT(uncompressed == payload);
+    }
+    qDebug() << payload.size() << "bytes compressed to" << compressed.size();
+}
+
 void BenchmarksTest::benchQLocalSocketInt()
 {
     const QString socketName = QStringLiteral("benchLocalSocket");
@@ -198,6 +455,111 @@ void BenchmarksTest::benchQLocalSocketInt()
 #endif
 }
 
+void BenchmarksTest::benchTransportPropertyChangesInt_data()
+{
+    QTest::addColumn<QUrl>("hostUrl");
+
+    QTest::newRow("local") << QUrl(QStringLiteral("local:benchmark_transport"));
+#if QT_CONFIG(sharedmemory)
+    QTest::newRow("shm") << QUrl(QStringLiteral("shm:benchmark_transport"));
+#endif
+}
+
+// Same as benchPropertyChangesInt, for each transport between processes on the same device
+void BenchmarksTest::benchTransportPropertyChangesInt()
+{
+    QFETCH(QUrl, hostUrl);
+
+    QRemoteObjectHost host(hostUrl);
+    LocalDataCenterSimpleSource source;
+    host.enableRemoting(&source);
+    QRemoteObjectNode client;
+    client.connectToNode(hostUrl);
+    QScopedPointer<LocalDataCenterReplica> center(client.acquire<LocalDataCenterReplica>());
+    QVERIFY(center->waitForSource());
+
+    QEventLoop loop;
+    int lastValue = 0;
+    connect(center.data(), &LocalDataCenterReplica::data1Changed, [&lastValue, &loop]() {
+        if (++lastValue == 50000)
+            loop.quit();
+    });
+    QBENCHMARK {
+        lastValue = 0;
+        for (int i = 1; i <= 50000; ++i)
+            source.setData1(i);
+        loop.exec();
+    }
+}
+
+void BenchmarksTest::benchIoThreadReceive_data()
+{
+    QTest::addColumn<bool>("ioThread");
+
+    QTest::newRow("host thread") << false;
+    QTest::newRow("io thread") << true;
+}
+
+// CPU time the host's thread needs for 10k property changes pushed by a replica on another
+// thread. Wall-clock time would mostly measure the client and the I/O thread.
+void BenchmarksTest::benchIoThreadReceive()
+{
+    QFETCH(bool, ioThread);
+
+    if (threadCpuTime() < 0)
+        QSKIP("The CPU time of a thread can't be measured on this platform");
+
+    const QUrl url(QStringLiteral("local:benchmark_iothread"));
+    QRemoteObjectHost host;
+    host.setIoThreadEnabled(ioThread);
+    host.setHostUrl(url);
+    LocalDataCenterSimpleSource source;
+    host.enableRemoting(&source);
+
+    QThread clientThread;
+    clientThread.start();
+    QObject clientContext;
+    clientContext.moveToThread(&clientThread);
+    QScopedPointer<QRemoteObjectNode> client;
+    QScopedPointer<LocalDataCenterReplica> center;
+    QMetaObject::invokeMethod(&clientContext, [&client, &center, &url]() {
+        client.reset(new QRemoteObjectNode);
+        client->connectToNode(url);
+        center.reset(client->acquire<LocalDataCenterReplica>());
+    }, Qt::BlockingQueuedConnection);
+    QTRY_VERIFY(center->isInitialized());
+
+    QEventLoop loop;
+    int received = 0;
+    connect(&source, &LocalDataCenterSimpleSource::data1Changed, &loop, [&received, &loop]() {
+        if (++received == 10000)
+            loop.quit();
+    });
+    const int rounds = 10;
+    qint64 hostTime = 0;
+    for (int round = 0; round < rounds; ++round) {
+        received = 0;
+        QMetaObject::invokeMethod(&clientContext, [&center]() {
+            for (int i = 1; i <= 10000; ++i)
+                center->pushData1(i);
+        }, Qt::QueuedConnection);
+        const qint64 start = threadCpuTime();
+        loop.exec();
+        hostTime += threadCpuTime() - start;
+    }
+    // QTest has no metric for CPU time, CPUTicks at least keeps it apart from wall-clock results.
+    // The value is in nanoseconds of the host thread's CPU time per round.
+    QTest::setBenchmarkResult(qreal(hostTime) / rounds, QTest::CPUTicks);
+    qDebug() << "host thread CPU time per round:" << qreal(hostTime) / rounds / 1000000 << "ms";
+
+    QMetaObject::invokeMethod(&clientContext, [&client, &center]() {
+        center.reset();
+        client.reset();
+    }, Qt::BlockingQueuedConnection);
+    clientThread.quit();
+    clientThread.wait();
+}
+
 void BenchmarksTest::benchQLocalSocketQDataStreamInt()
 {
     const QString socketName = QStringLiteral("benchLocalSocket");
@@ -390,6 +752,81 @@ void BenchmarksTest::benchModelRandomAccess()
     }
 }
 
+void BenchmarksTest::benchModelTopInsert_data()
+{
+    QTest::addColumn<int>("insertions");
+    QTest::addColumn<int>("rowsPerInsertion");
+
+    QTest::newRow("1000x1") << 1000 << 1;
+    QTest::newRow("1x10000") << 1 << 10000;
+}
+
+// Rows inserted at the top of a replica of 1M rows, with the first rows cached
+void BenchmarksTest::benchModelTopInsert()
+{
+    QFETCH(int, insertions);
+    QFETCH(int, rowsPerInsertion);
+
+    const QUrl url(QStringLiteral("local:benchmark_insert"));
+    GrowingModel sourceModel;
+    QRemoteObjectHost host(url);
+    host.enableRemoting(&sourceModel, QStringLiteral("GrowingModel"), {Qt::DisplayRole});
+    QRemoteObjectNode client;
+    client.connectToNode(url);
+    QScopedPointer<QAbstractItemModelReplica> model(client.acquireModel(QStringLiteral("GrowingModel"), QtRemoteObjects::PrefetchData));
+    QTRY_VERIFY(model->isInitialized());
+    QTRY_COMPARE(model->rowCount(), sourceModel.rowCount());
+
+    QEventLoop loop;
+    int expectedRows = 0;
+    connect(model.data(), &QAbstractItemModel::rowsInserted, &loop, [&model, &loop, &expectedRows]() {
+        if (model->rowCount() == expectedRows)
+            loop.quit();
+    });
+    QBENCHMARK {
+        expectedRows = sourceModel.rowCount() + insertions * rowsPerInsertion;
+        for (int i = 0; i < insertions; ++i)
+            sourceModel.insertAtTop(rowsPerInsertion);
+        loop.exec();
+    }
+    QCOMPARE(model->rowCount(), sourceModel.rowCount());
+}
+
+void BenchmarksTest::benchModelMultiRoleFetch_data()
+{
+    QTest::addColumn<bool>("proxy");
+
+    QTest::newRow("model") << false;
+    QTest::newRow("identity proxy") << true;
+}
+
+// Prefetches the first cells of a wide model with all of its roles into new replicas
+void BenchmarksTest::benchModelMultiRoleFetch()
+{
+    QFETCH(bool, proxy);
+
+    const QUrl url(QStringLiteral("local:benchmark_multirole"));
+    const QVector<int> roles = WideModel::roles();
+    WideModel sourceModel;
+    WideProxyModel proxyModel;
+    proxyModel.setSourceModel(&sourceModel);
+    QRemoteObjectHost host(url);
+    host.enableRemoting(proxy ? static_cast<QAbstractItemModel *>(&proxyModel) : &sourceModel,
+                        QStringLiteral("WideModel"), roles);
+    QRemoteObjectNode client;
+    client.connectToNode(url);
+
+    QBENCHMARK {
+        QScopedPointer<QAbstractItemModelReplica> model(client.acquireModel(QStringLiteral("WideModel"), QtRemoteObjects::PrefetchData, roles));
+        QEventLoop loop;
+        connect(model.data(), &QAbstractItemModel::modelReset, &loop, &QEventLoop::quit);
+        QTimer::singleShot(30000, &loop, &QEventLoop::quit);
+        loop.exec();
+        QVERIFY(model->hasData(model->index(0, 1), roles.last()));
+        QCOMPARE(model->data(model->index(0, 1), roles.last()), QVariant(8));
+    }
+}
+
 QTEST_MAIN(BenchmarksTest)
 
 #include "tst_benchmarkstest.moc"
@@ -7,6 +7,7 @@ OTHER_FILES = engine.rep \
 REPC_SOURCE += $$OTHER_FILES
 REPC_REPLICA += $$OTHER_FILES
 REPC_MERGED += speedometer.rep enum.rep pod.rep
+REPC_OPTIONS = --future
 
 HEADERS += engine.h \
            speedometer.h \
@@ -17,7 +18,7 @@ SOURCES += engine.cpp \
            tst_integration.cpp
 
 CONFIG += testcase
-QT += testlib remoteobjects
+QT += testlib remoteobjects remoteobjects-private
 QT -= gui
 
 contains(QT_CONFIG, c++11): CONFIG += c++11
@@ -38,6 +38,9 @@
 #include <QRemoteObjectReplica>
 #include <QRemoteObjectNode>
 #include <QRemoteObjectSettingsStore>
+#include <QtRemoteObjects/private/qconnectionfactories_p.h>
+#include <QtRemoteObjects/private/qremoteobjectnode_p.h>
+#include <QtRemoteObjects/private/qremoteobjectsource_p.h>
 #include "engine.h"
 #include "speedometer.h"
 #include "rep_engine_replica.h"
@@ -60,9 +63,41 @@ bool operator<(const QVector<int> &lhs, const QVector<int> &rhs)
 class TestLargeData: public QObject
 {
     Q_OBJECT
+    Q_PROPERTY(int value READ value WRITE setValue NOTIFY valueChanged)
+
+public:
+    int value() const { return m_value; }
+    void setValue(int value)
+    {
+        if (m_value == value)
+            return;
+
+        m_value = value;
+        emit valueChanged();
+    }
 
 Q_SIGNALS:
     void send(const QByteArray &data);
+    void valueChanged();
+    void marker(int value);
+
+private:
+    int m_value = 0;
+};
+
+// Reads the value property of a replica when one of its signals is received
+class ValueRecorder : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ValueRecorder(QObject *replica) : m_replica(replica) {}
+    int value = -1;
+
+public Q_SLOTS:
+    void record() { value = m_replica->property("value").toInt(); }
+
+private:
+    QObject *m_replica;
 };
 
 class TestDynamicBase : public QObject
@@ -215,6 +250,9 @@ private slots:
         QTest::newRow("qnx") << QUrl(QLatin1String("qnx:replica")) << QUrl(QLatin1String("qnx:registry"));
 #endif
         QTest::newRow("local") << QUrl(QLatin1String("local:replicaLocalIntegration")) << QUrl(QLatin1String("local:registryLocalIntegration"));
+#if QT_CONFIG(sharedmemory)
+        QTest::newRow("shm") << QUrl(QLatin1String("shm:replicaShmIntegration")) << QUrl(QLatin1String("shm:registryShmIntegration"));
+#endif
         QTest::newRow("external") << QUrl() << QUrl();
     }
 
@@ -1045,6 +1083,706 @@ private slots:
         QCOMPARE(engine_r->rpm(), e.rpm());
     }
 
+    // the source gets a new object id when it is remoted again, make sure the
+    // replica doesn't keep using the stale one
+    void reenableRemotingTest()
+    {
+        setupHost();
+        Engine e;
+        host->enableRemoting(&e);
+
+        setupClient();
+
+        e.setRpm(1000);
+
+        QScopedPointer<EngineReplica> engine_r(client->acquire<EngineReplica>());
+        QVERIFY(engine_r->waitForSource());
+        QCOMPARE(engine_r->rpm(), 1000);
+
+        engine_r.reset();
+        host->disableRemoting(&e);
+        host->enableRemoting(&e);
+
+        engine_r.reset(client->acquire<EngineReplica>());
+        QVERIFY(engine_r->waitForSource());
+        e.setRpm(2000);
+        QTRY_COMPARE(engine_r->rpm(), 2000);
+
+        QRemoteObjectPendingReply<bool> reply = engine_r->start();
+        QVERIFY(reply.waitForFinished());
+        QCOMPARE(reply.returnValue(), true);
+        QTRY_COMPARE(engine_r->started(), true);
+    }
+
+    void deltaInitTest()
+    {
+        setupHost();
+        Engine e;
+        e.setRpm(1000);
+        e.setEngineType(EngineSimpleSource::ELECTRIC);
+        host->enableRemoting(&e);
+
+        setupClient();
+
+        QScopedPointer<EngineReplica> engine_r(client->acquire<EngineReplica>());
+        QVERIFY(engine_r->waitForSource());
+        QCOMPARE(engine_r->rpm(), 1000);
+
+        host->disableRemoting(&e);
+        QTRY_COMPARE(engine_r->state(), QRemoteObjectReplica::Suspect);
+
+        // Only rpm changes while the replica is disconnected
+        e.setRpm(2000);
+        QSignalSpy spy(engine_r.data(), &EngineReplica::engineTypeChanged);
+        host->enableRemoting(&e);
+        QTRY_COMPARE(engine_r->state(), QRemoteObjectReplica::Valid);
+        QCOMPARE(engine_r->rpm(), 2000);
+        QCOMPARE(engine_r->engineType(), EngineReplica::ELECTRIC);
+        QCOMPARE(spy.count(), 0);
+    }
+
+    void compressionTest()
+    {
+        setupHost();
+        host->setCompressionThreshold(64);
+        Engine e;
+        e.setRpm(1000);
+        host->enableRemoting(&e);
+
+        setupClient();
+        client->setCompressionThreshold(64);
+
+        QScopedPointer<EngineReplica> engine_r(client->acquire<EngineReplica>());
+        QVERIFY(engine_r->waitForSource());
+
+        // Large enough to be compressed in both directions
+        const QString text(10000, QLatin1Char('x'));
+        engine_r->setMyTestString(text);
+        QRemoteObjectPendingReply<QString> reply = engine_r->myTestString();
+        QVERIFY(reply.waitForFinished());
+        QCOMPARE(reply.returnValue(), text);
+
+        // Too large for one CompressedBatch, so the packet spans several of them
+        const QString largeText(3 * 1024 * 1024, QLatin1Char('y'));
+        engine_r->setMyTestString(largeText);
+        reply = engine_r->myTestString();
+        QVERIFY(reply.waitForFinished());
+        QCOMPARE(reply.returnValue(), largeText);
+
+        // The class definition sent to dynamic replicas is compressed as well
+        QScopedPointer<QRemoteObjectDynamicReplica> engine_dr(client->acquireDynamic(QStringLiteral("Engine")));
+        QVERIFY(engine_dr->waitForSource());
+        QCOMPARE(engine_dr->property("rpm").toInt(), 1000);
+    }
+
+    void ioThreadTest()
+    {
+        setupHost();
+        host->setIoThreadEnabled(true);
+        QVERIFY(host->isIoThreadEnabled());
+        Engine e;
+        e.setRpm(1000);
+        host->enableRemoting(&e);
+
+        setupClient();
+
+        QScopedPointer<EngineReplica> engine_r(client->acquire<EngineReplica>());
+        QVERIFY(engine_r->waitForSource());
+        QCOMPARE(engine_r->rpm(), 1000);
+
+        for (int i = 1; i <= 100; ++i)
+            e.setRpm(i);
+        QTRY_COMPARE(engine_r->rpm(), 100);
+
+        engine_r->setRpm(42);
+        QTRY_COMPARE(e.rpm(), 42);
+
+        QRemoteObjectPendingReply<bool> reply = engine_r->start();
+        QVERIFY(reply.waitForFinished());
+        QVERIFY(reply.returnValue());
+        QTRY_VERIFY(engine_r->started());
+    }
+
+    void reconnectTest()
+    {
+        QFETCH_GLOBAL(QUrl, hostUrl);
+        if (hostUrl.isEmpty())
+            QSKIP("Only connections made with connectToNode() are reconnected");
+
+        setupHost();
+        Engine e;
+        e.setRpm(1000);
+        host->enableRemoting(&e);
+
+        setupClient();
+
+        QScopedPointer<EngineReplica> engine_r(client->acquire<EngineReplica>());
+        QVERIFY(engine_r->waitForSource());
+        QCOMPARE(client->reconnectCount(), quint64(0));
+
+        delete host;
+        QTRY_COMPARE(engine_r->state(), QRemoteObjectReplica::Suspect);
+
+        e.setRpm(2000);
+        setupHost();
+        host->enableRemoting(&e);
+        QTRY_COMPARE_WITH_TIMEOUT(engine_r->state(), QRemoteObjectReplica::Valid, 10000);
+        QCOMPARE(engine_r->rpm(), 2000);
+        QCOMPARE(client->reconnectCount(), quint64(1));
+        QVERIFY(client->lastReconnectLatency() > 0);
+        QCOMPARE(client->maxReconnectLatency(), client->lastReconnectLatency());
+    }
+
+    void maxConcurrentHandshakesTest()
+    {
+        QFETCH_GLOBAL(QUrl, hostUrl);
+        if (hostUrl.isEmpty())
+            QSKIP("Connections added with addHostSideConnection() are not limited");
+
+        setupHost();
+        host->setMaxConcurrentHandshakes(1);
+        QCOMPARE(host->maxConcurrentHandshakes(), 1);
+        Engine e;
+        e.setRpm(1234);
+        host->enableRemoting(&e);
+
+        QVector<QRemoteObjectNode *> clients;
+        QVector<EngineReplica *> replicas;
+        int initialized = 0;
+        for (int i = 0; i < 4; ++i) {
+            auto node = new QRemoteObjectNode;
+            node->connectToNode(hostUrl);
+            clients.append(node);
+            replicas.append(node->acquire<EngineReplica>());
+            connect(replicas.last(), &QRemoteObjectReplica::initialized, this, [&initialized]() { ++initialized; });
+        }
+
+        // A connection is only greeted once every earlier one got its Init
+        auto io = static_cast<QRemoteObjectHostBasePrivate *>(QObjectPrivate::get(host))->remoteObjectIo;
+        const QRemoteObjectRootSource *source = io->m_sourceRoots.value(QStringLiteral("Engine"));
+        QVERIFY(source);
+        bool greetedOneAtATime = true;
+        int maxDeferred = 0;
+        QDeadlineTimer deadline(10000);
+        while (initialized < replicas.size() && !deadline.hasExpired()) {
+            QTest::qWait(10);
+            greetedOneAtATime = greetedOneAtATime && io->m_connections.size() <= source->d->m_listeners.size() + 1;
+            maxDeferred = qMax(maxDeferred, io->m_deferredConnections.size());
+        }
+        QCOMPARE(initialized, replicas.size());
+        QVERIFY(greetedOneAtATime);
+        QVERIFY(maxDeferred > 0);
+        for (EngineReplica *replica : qAsConst(replicas))
+            QCOMPARE(replica->rpm(), 1234);
+
+        qDeleteAll(replicas);
+        qDeleteAll(clients);
+    }
+
+    void tcpHostNameTest()
+    {
+        QFETCH_GLOBAL(QUrl, hostUrl);
+        if (hostUrl.scheme() != QRemoteObjectStringLiterals::tcp())
+            QSKIP("Only applies to tcp connections");
+
+        // localhost usually resolves to more than one address, not all of them accepted
+        QRemoteObjectHost hostByAddress(QUrl(QLatin1String("tcp://127.0.0.1:65513")));
+        Engine e;
+        e.setRpm(1234);
+        hostByAddress.enableRemoting(&e);
+
+        QRemoteObjectNode first;
+        QVERIFY(first.connectToNode(QUrl(QLatin1String("tcp://localhost:65513"))));
+        QScopedPointer<EngineReplica> engine_r(first.acquire<EngineReplica>());
+        QVERIFY(engine_r->waitForSource());
+        QCOMPARE(engine_r->rpm(), 1234);
+
+        // Connects with the addresses resolved for the first node
+        QRemoteObjectNode second;
+        QVERIFY(second.connectToNode(QUrl(QLatin1String("tcp://localhost:65513"))));
+        QScopedPointer<EngineReplica> engine_r2(second.acquire<EngineReplica>());
+        QVERIFY(engine_r2->waitForSource());
+        QCOMPARE(engine_r2->rpm(), 1234);
+    }
+
+    void batchedCallsTest()
+    {
+        setupHost();
+        Engine e;
+        e.setRpm(0);
+        e.setMyTestString(QLatin1String("batched"));
+        host->enableRemoting(&e);
+
+        setupClient();
+
+        QScopedPointer<EngineReplica> engine_r(client->acquire<EngineReplica>());
+        QVERIFY(engine_r->waitForSource());
+
+        engine_r->beginBatch();
+        engine_r->setRpm(100);
+        for (int i = 0; i < 10; ++i)
+            engine_r->increaseRpm(1);
+        QRemoteObjectPendingReply<bool> started = engine_r->start();
+        QRemoteObjectPendingReply<QString> text = engine_r->myTestString();
+        // Nested batches are sent with the outermost one
+        engine_r->beginBatch();
+        engine_r->increaseRpm(5);
+        QVERIFY(engine_r->commitBatch());
+        QTest::qWait(50);
+        QCOMPARE(e.rpm(), 0);
+        QVERIFY(!started.isFinished());
+        QVERIFY(engine_r->commitBatch());
+
+        QVERIFY(started.waitForFinished());
+        QVERIFY(started.returnValue());
+        QVERIFY(text.waitForFinished());
+        QCOMPARE(text.returnValue(), QLatin1String("batched"));
+        QCOMPARE(e.rpm(), 115);
+        QTRY_COMPARE(engine_r->rpm(), 115);
+    }
+
+    void heartbeatTest()
+    {
+        setupHost();
+        Engine e;
+        host->enableRemoting(&e);
+
+        setupClient();
+        client->setHeartbeatInterval(50);
+
+        QScopedPointer<EngineReplica> engine_r(client->acquire<EngineReplica>());
+        QScopedPointer<EngineReplica> engine_r2(client->acquire<EngineReplica>());
+        QVERIFY(engine_r->waitForSource());
+        QVERIFY(engine_r2->waitForSource());
+
+        // An idle source keeps its replicas valid by answering the connection's Pings
+        QSignalSpy stateSpy(engine_r.data(), &QRemoteObjectReplica::stateChanged);
+        QTest::qWait(500);
+        QCOMPARE(stateSpy.count(), 0);
+        QCOMPARE(engine_r->state(), QRemoteObjectReplica::Valid);
+        QCOMPARE(engine_r2->state(), QRemoteObjectReplica::Valid);
+
+        e.setRpm(42);
+        QTRY_COMPARE(engine_r2->rpm(), 42);
+        client->setHeartbeatInterval(0);
+    }
+
+    void heartbeatSilentHostTest()
+    {
+        QFETCH_GLOBAL(QUrl, hostUrl);
+        if (hostUrl.scheme() != QRemoteObjectStringLiterals::tcp()
+                && hostUrl.scheme() != QRemoteObjectStringLiterals::local())
+            QSKIP("Needs a host on another thread, reachable by its url");
+
+        QThread hostThread;
+        hostThread.start();
+        QObject hostContext;
+        hostContext.moveToThread(&hostThread);
+        QRemoteObjectHost *silentHost = nullptr;
+        Engine *e = nullptr;
+        QMetaObject::invokeMethod(&hostContext, [&]() {
+            silentHost = new QRemoteObjectHost(hostUrl);
+            e = new Engine;
+            e->setRpm(1234);
+            silentHost->enableRemoting(e);
+        }, Qt::BlockingQueuedConnection);
+
+        setupClient();
+        client->setHeartbeatInterval(50);
+        QScopedPointer<EngineReplica> engine_r(client->acquire<EngineReplica>());
+        QVERIFY(engine_r->waitForSource());
+        QCOMPARE(engine_r->rpm(), 1234);
+
+        // The host stops answering, but keeps its sockets open
+        QSemaphore resume;
+        QMetaObject::invokeMethod(&hostContext, [&resume]() { resume.acquire(); }, Qt::QueuedConnection);
+        QTRY_COMPARE(engine_r->state(), QRemoteObjectReplica::Suspect);
+        QCOMPARE(engine_r->rpm(), 1234);
+
+        // Once it answers again, the replica reconnects
+        resume.release();
+        QTRY_COMPARE_WITH_TIMEOUT(engine_r->state(), QRemoteObjectReplica::Valid, 10000);
+        client->setHeartbeatInterval(0);
+
+        engine_r.reset();
+        QMetaObject::invokeMethod(&hostContext, [&]() {
+            delete silentHost;
+            delete e;
+        }, Qt::BlockingQueuedConnection);
+        hostThread.quit();
+        QVERIFY(hostThread.wait(5000));
+    }
+
+    void heartbeatPingPerConnectionTest()
+    {
+        setupHost();
+        Engine e;
+        Engine e2;
+        host->enableRemoting(&e);
+        host->enableRemoting(&e2, QStringLiteral("Engine2"));
+
+        setupClient();
+        QScopedPointer<EngineReplica> engine_r(client->acquire<EngineReplica>());
+        QScopedPointer<EngineReplica> engine_r2(client->acquire<EngineReplica>(QStringLiteral("Engine2")));
+        QVERIFY(engine_r->waitForSource());
+        QVERIFY(engine_r2->waitForSource());
+        QTest::qWait(100);
+
+        auto io = static_cast<QRemoteObjectHostBasePrivate *>(QObjectPrivate::get(host))->remoteObjectIo;
+        const quint64 receivedPings = io->m_receivedPings;
+        // Ticks of the heartbeat timer, driven by hand. The first one only notes the traffic so
+        // far, the second one pings the now idle connection and the third one sees the Pong.
+        auto d = static_cast<QRemoteObjectNodePrivate *>(QObjectPrivate::get(client));
+        d->checkHeartbeats();
+        d->checkHeartbeats();
+        QTest::qWait(200);
+        d->checkHeartbeats();
+        QTest::qWait(100);
+
+        // Both replicas share the connection, so they share its Ping
+        QCOMPARE(io->m_receivedPings - receivedPings, quint64(1));
+        QCOMPARE(engine_r->state(), QRemoteObjectReplica::Valid);
+        QCOMPARE(engine_r2->state(), QRemoteObjectReplica::Valid);
+    }
+
+    void callTimeoutTest()
+    {
+        setupHost();
+        Engine e;
+        host->enableRemoting(&e);
+
+        setupClient();
+        client->setCallTimeout(200);
+        client->setMaxPendingCalls(2);
+        QCOMPARE(client->maxPendingCalls(), 2);
+
+        QScopedPointer<EngineReplica> engine_r(client->acquire<EngineReplica>());
+        QVERIFY(engine_r->waitForSource());
+
+        QRemoteObjectPendingReply<bool> answered = engine_r->start();
+        QCOMPARE(engine_r->pendingCallCount(), 1);
+        QVERIFY(answered.waitForFinished());
+        QCOMPARE(answered.error(), QRemoteObjectPendingCall::NoError);
+        QCOMPARE(engine_r->pendingCallCount(), 0);
+
+        // Only two calls wait for a reply, the third one gives up on the oldest
+        QRemoteObjectPendingReply<bool> first = engine_r->start();
+        QRemoteObjectPendingReply<bool> second = engine_r->start();
+        QRemoteObjectPendingReply<bool> third = engine_r->start();
+        QCOMPARE(first.error(), QRemoteObjectPendingCall::Timeout);
+        QCOMPARE(engine_r->pendingCallCount(), 2);
+        QVERIFY(!first.waitForFinished());
+        QVERIFY(second.waitForFinished());
+        QVERIFY(third.waitForFinished());
+        QCOMPARE(engine_r->expiredCallCount(), quint64(1));
+
+        // The source is gone before the call reaches it, so it never replies
+        QRemoteObjectPendingReply<bool> lost = engine_r->start();
+        host->disableRemoting(&e);
+        // Finishing because of the timeout is no success
+        QVERIFY(!lost.waitForFinished(5000));
+        QCOMPARE(lost.error(), QRemoteObjectPendingCall::Timeout);
+        QVERIFY(lost.isFinished());
+        QVERIFY(!lost.waitForFinished());
+        QCOMPARE(engine_r->pendingCallCount(), 0);
+        QCOMPARE(engine_r->expiredCallCount(), quint64(2));
+    }
+
+    void futureTest()
+    {
+        setupHost();
+        Engine e;
+        e.setRpm(0);
+        e.setMyTestString(QLatin1String("future"));
+        host->enableRemoting(&e);
+
+        setupClient();
+
+        QScopedPointer<EngineReplica> engine_r(client->acquire<EngineReplica>());
+        QVERIFY(engine_r->waitForSource());
+
+        QFuture<QString> text = engine_r->myTestStringAsync();
+        QString continued;
+        text.then([&continued](const QString &value) { continued = value + QLatin1String("!"); });
+        QFuture<bool> started = engine_r->startAsync();
+        QTRY_VERIFY(started.isFinished());
+        QVERIFY(started.result());
+        QTRY_COMPARE(continued, QLatin1String("future!"));
+        QCOMPARE(text.result(), QLatin1String("future"));
+
+        // Also finished when the reply is asked for after it arrived
+        QRemoteObjectPendingReply<bool> reply = engine_r->start();
+        QVERIFY(reply.waitForFinished());
+        QFuture<bool> late = reply.future();
+        QVERIFY(late.isFinished());
+        QVERIFY(late.result());
+
+        // A call that can't get a reply anymore cancels the future
+        QFuture<QString> pending = engine_r->myTestStringAsync();
+        engine_r.reset();
+        QTRY_VERIFY(pending.isFinished());
+        QVERIFY(pending.isCanceled());
+    }
+
+    void blockingWaitTest()
+    {
+        QFETCH_GLOBAL(QUrl, hostUrl);
+        if (hostUrl.scheme() != QRemoteObjectStringLiterals::tcp()
+                && hostUrl.scheme() != QRemoteObjectStringLiterals::local())
+            QSKIP("Only TCP and local sockets are waited on without an event loop");
+
+        // Nothing but the replica's connection is served while waiting, so the source lives
+        // on another thread
+        QThread hostThread;
+        hostThread.start();
+        QObject context;
+        context.moveToThread(&hostThread);
+        QRemoteObjectHost *threadHost = nullptr;
+        Engine *e = nullptr;
+        QMetaObject::invokeMethod(&context, [&] {
+            threadHost = new QRemoteObjectHost(hostUrl);
+            e = new Engine;
+            e->setMyTestString(QLatin1String("blocking"));
+            threadHost->enableRemoting(e);
+        }, Qt::BlockingQueuedConnection);
+
+        {
+            QRemoteObjectNode node;
+            QVERIFY(node.connectToNode(hostUrl));
+            QScopedPointer<EngineReplica> engine_r(node.acquire<EngineReplica>());
+            QVERIFY(engine_r->waitForSource());
+
+            bool timerFired = false;
+            QTimer::singleShot(0, [&timerFired]() { timerFired = true; });
+            QRemoteObjectPendingReply<QString> text = engine_r->myTestString();
+            QVERIFY(text.waitForFinished());
+            QCOMPARE(text.returnValue(), QLatin1String("blocking"));
+            QVERIFY(!timerFired);
+            QRemoteObjectPendingReply<bool> started = engine_r->start();
+            QVERIFY(started.waitForFinished());
+            QVERIFY(started.returnValue());
+            QVERIFY(!timerFired);
+            QTRY_VERIFY(timerFired);
+        }
+
+        QMetaObject::invokeMethod(&context, [&] {
+            delete threadHost;
+            delete e;
+        }, Qt::BlockingQueuedConnection);
+        hostThread.quit();
+        QVERIFY(hostThread.wait(5000));
+    }
+
+    void propertySnapshotTest()
+    {
+        setupHost();
+        Engine e;
+        e.setRpm(0);
+        host->enableRemoting(&e);
+
+        setupClient();
+
+        QScopedPointer<EngineReplica> engine_r(client->acquire<EngineReplica>());
+        QVERIFY(engine_r->waitForSource());
+        const int rpmIndex = engine_r->metaObject()->indexOfProperty("rpm")
+                - QRemoteObjectReplica::staticMetaObject.propertyCount();
+        QCOMPARE(engine_r->propertySnapshot().size(),
+                 engine_r->metaObject()->propertyCount() - QRemoteObjectReplica::staticMetaObject.propertyCount());
+        QCOMPARE(engine_r->propertySnapshot().at(rpmIndex).toInt(), 0);
+
+        // Read from another thread while the replica applies changes, values must only grow
+        QAtomicInt done;
+        bool ordered = true;
+        QScopedPointer<QThread> reader(QThread::create([&] {
+            int last = 0;
+            while (!done.loadAcquire()) {
+                const QVariantList values = engine_r->propertySnapshot();
+                if (values.size() <= rpmIndex) {
+                    ordered = false;
+                    break;
+                }
+                const int rpm = values.at(rpmIndex).toInt();
+                ordered = ordered && rpm >= last;
+                last = rpm;
+            }
+        }));
+        reader->start();
+
+        for (int i = 1; i <= 1000; ++i)
+            e.setRpm(i);
+        QTRY_COMPARE(engine_r->rpm(), 1000);
+        QVariantList values = engine_r->propertySnapshot();
+        QVERIFY(values.size() > rpmIndex);
+        QCOMPARE(values.at(rpmIndex).toInt(), 1000);
+
+        done.storeRelease(1);
+        QVERIFY(reader->wait(5000));
+        QVERIFY(ordered);
+
+        // A replica first asked from another thread publishes its values on its own thread
+        engine_r.reset();
+        QScopedPointer<EngineReplica> second_r(client->acquire<EngineReplica>());
+        QVERIFY(second_r->waitForSource());
+        QScopedPointer<QThread> firstReader(QThread::create([&] {
+            values = second_r->propertySnapshot();
+        }));
+        firstReader->start();
+        QTRY_VERIFY(firstReader->isFinished());
+        QVERIFY(values.size() > rpmIndex);
+        QCOMPARE(values.at(rpmIndex).toInt(), 1000);
+    }
+
+    void ioThreadPoolTest()
+    {
+        QFETCH_GLOBAL(QUrl, hostUrl);
+        if (hostUrl.isEmpty())
+            QSKIP("Connections added with addHostSideConnection() are not moved to I/O threads");
+        if (hostUrl.scheme() != QRemoteObjectStringLiterals::tcp()
+                && hostUrl.scheme() != QRemoteObjectStringLiterals::local())
+            QSKIP("Only tcp and local connections are moved to I/O threads");
+
+        setupHost();
+        host->setIoThreadEnabled(true);
+        host->setIoThreadCount(2);
+        QCOMPARE(host->ioThreadCount(), 2);
+        Engine e;
+        host->enableRemoting(&e);
+
+        QVector<QRemoteObjectNode *> clients;
+        QVector<EngineReplica *> replicas;
+        for (int i = 0; i < 3; ++i) {
+            auto node = new QRemoteObjectNode(this);
+            node->connectToNode(hostUrl);
+            auto replica = node->acquire<EngineReplica>();
+            clients.append(node);
+            replicas.append(replica);
+        }
+        for (EngineReplica *replica : qAsConst(replicas))
+            QVERIFY(replica->waitForSource());
+
+        // The first two connections get a thread each, the third shares the less busy one
+        auto d = static_cast<QRemoteObjectHostBasePrivate *>(QObjectPrivate::get(host));
+        QHash<QThread *, int> connectionsPerThread;
+        for (IoDeviceBase *conn : qAsConst(d->remoteObjectIo->m_connections))
+            ++connectionsPerThread[conn->ioThread()];
+        QCOMPARE(connectionsPerThread.size(), 2);
+        QVERIFY(!connectionsPerThread.contains(QThread::currentThread()));
+        QVERIFY(connectionsPerThread.values().contains(1));
+        QVERIFY(connectionsPerThread.values().contains(2));
+
+        e.setRpm(1234);
+        for (EngineReplica *replica : qAsConst(replicas))
+            QTRY_COMPARE(replica->rpm(), 1234);
+
+        qDeleteAll(replicas);
+        qDeleteAll(clients);
+    }
+
+    void propertyConflationTest()
+    {
+        setupHost();
+        TestLargeData t;
+        host->enableRemoting(&t, QStringLiteral("large"));
+        QVERIFY(host->setPropertyConflationEnabled(&t, true));
+
+        setupClient();
+
+        const QScopedPointer<QRemoteObjectDynamicReplica> rep(client->acquireDynamic(QStringLiteral("large")));
+        QVERIFY(rep->waitForSource());
+        QSignalSpy valueSpy(rep.data(), SIGNAL(valueChanged()));
+        QSignalSpy markerSpy(rep.data(), SIGNAL(marker(int)));
+        ValueRecorder recorder(rep.data());
+        QVERIFY(connect(rep.data(), SIGNAL(marker(int)), &recorder, SLOT(record())));
+
+        // The socket can't take this at once, so the value changes below wait behind it
+        emit t.send(QByteArray(8 * 1024 * 1024, 'x'));
+        for (int i = 1; i <= 100; ++i)
+            t.setValue(i);
+        // Must not overtake the value that was current when it was emitted
+        emit t.marker(100);
+
+        QTRY_COMPARE_WITH_TIMEOUT(markerSpy.count(), 1, 30000);
+        QCOMPARE(recorder.value, 100);
+        QCOMPARE(valueSpy.count(), 1);
+
+        QObject notRemoted;
+        QVERIFY(!host->setPropertyConflationEnabled(&notRemoted, true));
+    }
+
+    void sendQueueLimitsTest_data()
+    {
+        QTest::addColumn<QRemoteObjectHostBase::SendQueuePolicy>("policy");
+
+        QTest::newRow("DropOldestPackets") << QRemoteObjectHostBase::DropOldestPackets;
+        QTest::newRow("ConflatePropertyChanges") << QRemoteObjectHostBase::ConflatePropertyChanges;
+        QTest::newRow("DisconnectClient") << QRemoteObjectHostBase::DisconnectClient;
+        QTest::newRow("SuspendClient") << QRemoteObjectHostBase::SuspendClient;
+    }
+
+    void sendQueueLimitsTest()
+    {
+        QFETCH_GLOBAL(QUrl, hostUrl);
+        QFETCH(QRemoteObjectHostBase::SendQueuePolicy, policy);
+
+        setupHost();
+        host->setSendQueueLimits(64 * 1024, 16 * 1024, policy);
+        TestLargeData t;
+        host->enableRemoting(&t, QStringLiteral("large"));
+
+        setupClient();
+
+        const QScopedPointer<QRemoteObjectDynamicReplica> rep(client->acquireDynamic(QStringLiteral("large")));
+        QVERIFY(rep->waitForSource());
+        QCOMPARE(host->queuedBytes().size(), 1);
+        QSignalSpy highSpy(host, &QRemoteObjectHostBase::sendQueueHighWatermarkReached);
+        QSignalSpy lowSpy(host, &QRemoteObjectHostBase::sendQueueLowWatermarkReached);
+        QSignalSpy valueSpy(rep.data(), SIGNAL(valueChanged()));
+        QSignalSpy markerSpy(rep.data(), SIGNAL(marker(int)));
+
+        // The socket can't take this at once, which congests the connection right away
+        emit t.send(QByteArray(8 * 1024 * 1024, 'x'));
+        QCOMPARE(highSpy.count(), 1);
+        for (int i = 1; i <= 1000; ++i)
+            t.setValue(i);
+        emit t.marker(1000);
+
+        if (policy == QRemoteObjectHostBase::DisconnectClient) {
+            QTRY_COMPARE(host->backpressureDisconnectCount(), quint64(1));
+            // Host side connections are not reestablished
+            if (hostUrl.isEmpty())
+                return;
+        } else {
+            QTRY_COMPARE_WITH_TIMEOUT(lowSpy.count(), 1, 30000);
+        }
+        QTRY_COMPARE_WITH_TIMEOUT(rep->property("value").toInt(), 1000, 30000);
+        QTRY_COMPARE(rep->state(), QRemoteObjectReplica::Valid);
+
+        switch (policy) {
+        case QRemoteObjectHostBase::DropOldestPackets:
+            // Superseded values were dropped, but never the last one
+            QVERIFY(host->droppedPacketCount() > 0);
+            QVERIFY(valueSpy.count() < 1000);
+            break;
+        case QRemoteObjectHostBase::ConflatePropertyChanges:
+            QCOMPARE(host->droppedPacketCount(), quint64(0));
+            QVERIFY(valueSpy.count() < 1000);
+            QTRY_COMPARE(markerSpy.count(), 1);
+            break;
+        case QRemoteObjectHostBase::SuspendClient:
+            // Nothing was sent while suspended, the value was resent once it drained
+            QCOMPARE(valueSpy.count(), 1);
+            QCOMPARE(markerSpy.count(), 0);
+            break;
+        default:
+            break;
+        }
+        QCOMPARE(host->backpressureDisconnectCount(), quint64(policy == QRemoteObjectHostBase::DisconnectClient ? 1 : 0));
+
+        // Changes after the queue drained reach the replica as usual
+        t.setValue(1001);
+        QTRY_COMPARE(rep->property("value").toInt(), 1001);
+    }
+
     void doubleReplicaTest()
     {
         setupHost();
@@ -527,6 +527,7 @@ private slots:
     void testFlags();
     void testDataChanged();
     void testDataChangedTree();
+    void testDataChangedInline();
     void testDataInsertion();
     void testDataInsertionTree();
     void testSetData();
@@ -545,6 +546,7 @@ private slots:
     void testChildSelection();
 
     void testCacheData();
+    void testPrefetch();
 
     void cleanup();
 };
@@ -769,6 +771,42 @@ void TestModelView::testDataChanged()
     compareData(&m_sourceModel, model.data());
 }
 
+void TestModelView::testDataChangedInline()
+{
+    _SETUP_TEST_
+    QVector<int> roles = {Qt::DisplayRole, Qt::BackgroundRole};
+    QStandardItemModel simpleModel;
+    for (int i = 0; i < 10; ++i)
+        simpleModel.appendRow({new QStandardItem(QString("item %0").arg(i)), new QStandardItem(QString("value %0").arg(i))});
+    basicServer.setModelDataInlineLimit(2);
+    QCOMPARE(basicServer.modelDataInlineLimit(), 2);
+    basicServer.enableRemoting(&simpleModel, "inlineModel", roles);
+
+    QScopedPointer<QAbstractItemModelReplica> model(client.acquireModel("inlineModel", QtRemoteObjects::PrefetchData, roles));
+    model->setRootCacheSize(10);
+    QTRY_COMPARE(model->rowCount(), simpleModel.rowCount());
+    QTRY_COMPARE(model->data(model->index(9, 1)), QVariant(QString("value 9")));
+
+    // Small changes carry the new values
+    QSignalSpy dataChangedSpy(model.data(), SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+    simpleModel.setData(simpleModel.index(3, 1), QStringLiteral("changed 3"));
+    QVERIFY(dataChangedSpy.wait());
+    QCOMPARE(dataChangedSpy.count(), 1);
+    QCOMPARE(dataChangedSpy.first().at(0).value<QModelIndex>(), model->index(3, 1));
+    QCOMPARE(model->data(model->index(3, 1)), QVariant(QString("changed 3")));
+
+    // Larger changes are fetched again
+    dataChangedSpy.clear();
+    QSignalBlocker blocker(&simpleModel);
+    for (int i = 0; i < simpleModel.rowCount(); ++i)
+        simpleModel.item(i, 1)->setText(QString("changed %0").arg(i));
+    blocker.unblock();
+    emit simpleModel.dataChanged(simpleModel.index(0, 1), simpleModel.index(9, 1), {Qt::DisplayRole});
+    QVERIFY(dataChangedSpy.wait());
+    QTRY_COMPARE(model->data(model->index(9, 1)), QVariant(QString("changed 9")));
+    compareData(&simpleModel, model.data());
+}
+
 void TestModelView::testDataInsertion()
 {
     _SETUP_TEST_
@@ -1188,6 +1226,31 @@ void TestModelView::testCacheData()
     compareData(&m_listModel, model.data());
 }
 
+void TestModelView::testPrefetch()
+{
+    _SETUP_TEST_
+    QScopedPointer<QAbstractItemModelReplica> model(client.acquireModel("testRoleNames"));
+    model->setPrefetchRows(20);
+    QCOMPARE(model->prefetchRows(), 20);
+    QTRY_COMPARE(model->rowCount(), m_listModel.rowCount());
+
+    // Reading the first rows reads the rows below them as well
+    for (int row = 0; row < 10; ++row)
+        model->data(model->index(row, 0), Qt::UserRole);
+    QCOMPARE(model->cacheMissCount(), quint64(10));
+    QCOMPARE(model->cacheHitCount(), quint64(0));
+    QTRY_VERIFY(model->hasData(model->index(29, 0), Qt::UserRole));
+    QVERIFY(!model->hasData(model->index(100, 0), Qt::UserRole));
+
+    for (int row = 0; row < 30; ++row)
+        QCOMPARE(model->data(model->index(row, 0), Qt::UserRole), m_listModel.data(m_listModel.index(row, 0), Qt::UserRole));
+    QCOMPARE(model->cacheHitCount(), quint64(30));
+
+    // Getting close to the end of the rows read ahead reads further
+    model->data(model->index(25, 0), Qt::UserRole);
+    QTRY_VERIFY(model->hasData(model->index(45, 0), Qt::UserRole));
+}
+
 void TestModelView::testChildSelection()
 {
     _SETUP_TEST_
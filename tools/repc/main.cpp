@@ -98,6 +98,10 @@ int main(int argc, char **argv)
     alwaysClassOption.setDescription(QStringLiteral("Always output `class` type for .rep files and never `POD`."));
     parser.addOption(alwaysClassOption);
 
+    QCommandLineOption futureOption(QStringLiteral("future"));
+    futureOption.setDescription(QStringLiteral("Also generate a <slot>Async() method returning a QFuture for each replica slot with a return value."));
+    parser.addOption(futureOption);
+
     QCommandLineOption debugOption(QStringLiteral("d"));
     debugOption.setDescription(QStringLiteral("Print out parsing debug information (for troubleshooting)."));
     parser.addOption(debugOption);
@@ -240,6 +244,7 @@ int main(int argc, char **argv)
         } else {
             Q_ASSERT(mode & OutReplica);
             RepCodeGenerator generator(&output);
+            generator.setGenerateFutures(parser.isSet(futureOption));
             generator.generate(classList2AST(moc.classList), RepCodeGenerator::REPLICA, outputFile);
         }
     } else {
@@ -259,6 +264,7 @@ int main(int argc, char **argv)
         input.close();
 
         RepCodeGenerator generator(&output);
+        generator.setGenerateFutures(parser.isSet(futureOption));
         if ((mode & OutMerged) == OutMerged)
             generator.generate(repparser.ast(), RepCodeGenerator::MERGED, outputFile);
         else if (mode & OutReplica)
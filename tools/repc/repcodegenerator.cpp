@@ -949,6 +949,12 @@ void RepCodeGenerator::generateClass(Mode mode, QTextStream &out, const ASTClass
                     else
                         out << "        return QRemoteObjectPendingReply<" << returnType << ">(sendWithReply(QMetaObject::InvokeMetaMethod, __repc_index, __repc_args));" << Qt::endl;
                     out << "    }" << Qt::endl;
+                    if (m_generateFutures && !isVoid) {
+                        out << "    QFuture<" << returnType << "> " << slot.name << "Async(" << slot.paramsAsString() << ")" << Qt::endl;
+                        out << "    {" << Qt::endl;
+                        out << "        return " << slot.name << "(" << slot.paramNames().join(QStringLiteral(", ")) << ").future();" << Qt::endl;
+                        out << "    }" << Qt::endl;
+                    }
                 }
             }
         }
@@ -58,6 +58,8 @@ public:
     explicit RepCodeGenerator(QIODevice *outputDevice);
 
     void generate(const AST &ast, Mode mode, QString fileName);
+    // Adds a <slot>Async() method returning a QFuture for replica slots with a return value
+    void setGenerateFutures(bool enabled) { m_generateFutures = enabled; }
 
     QByteArray classSignature(const ASTClass &ac);
 private:
@@ -88,6 +90,7 @@ private:
 private:
     QIODevice *m_outputDevice;
     QHash<QString, QByteArray> m_globalEnumsPODs;
+    bool m_generateFutures = false;
 };
 
 QT_END_NAMESPACE